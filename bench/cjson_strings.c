@@ -0,0 +1,103 @@
+/*
+ * Microbenchmark for the string paths of the bundled cJSON (print_string_ptr
+ * and parse_string). Build it once as is and once with -DCJSON_NO_SIMD to
+ * compare against the plain byte loop; `make bench` does both. The checksum
+ * covers every printed and parsed string and must match between the builds.
+ */
+#include <cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TOTAL_BYTES (256u << 20) // bytes pushed through each case
+
+typedef struct {
+    const char  *name;
+    size_t      len;
+    size_t      escape_every; // 0: no byte needs escaping
+}   bench_case_t;
+
+static const bench_case_t cases[] = {
+    { "short clean",        24,     0 },
+    { "header block",       2048,   40 },
+    { "clean 8k",           8192,   0 },
+    { "clean 64k",          65536,  0 },
+    { "escaped 64k",        65536,  16 },
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long fnv1a(unsigned long h, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ul;
+    }
+    return h;
+}
+
+static char* make_input(const bench_case_t *c) {
+    static const char escapes[] = "\"\\\n\r\t\x01";
+    char *s = malloc(c->len + 1);
+    if (!s) return NULL;
+
+    for (size_t i = 0; i < c->len; i++) {
+        s[i] = 'a' + (char)(i % 26);
+        if (c->escape_every && i % c->escape_every == c->escape_every - 1)
+            s[i] = escapes[(i / c->escape_every) % (sizeof(escapes) - 1)];
+    }
+    s[c->len] = 0;
+    return s;
+}
+
+int main(void) {
+    unsigned long checksum = 14695981039346656037ul;
+
+#ifdef CJSON_NO_SIMD
+    printf("cJSON string paths: scalar\n");
+#else
+    printf("cJSON string paths: simd\n");
+#endif
+    printf("%-14s %12s %12s\n", "case", "print MB/s", "parse MB/s");
+
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        const bench_case_t *c = &cases[k];
+        size_t iters = TOTAL_BYTES / c->len;
+        char *input = make_input(c);
+        cJSON *item = cJSON_CreateString(input);
+        char *printed = cJSON_PrintUnformatted(item);
+        size_t printed_len = strlen(printed);
+        char *buf = malloc(printed_len + 64);
+
+        double t0 = now_sec();
+        for (size_t i = 0; i < iters; i++) {
+            if (!cJSON_PrintPreallocated(item, buf, (int)(printed_len + 64), 0)) return 1;
+        }
+        double t_print = now_sec() - t0;
+        checksum = fnv1a(checksum, buf, printed_len);
+
+        t0 = now_sec();
+        for (size_t i = 0; i < iters; i++) {
+            cJSON *parsed = cJSON_ParseWithLength(printed, printed_len);
+            if (!parsed) return 1;
+            if (i == 0) checksum = fnv1a(checksum, parsed->valuestring, strlen(parsed->valuestring));
+            cJSON_Delete(parsed);
+        }
+        double t_parse = now_sec() - t0;
+
+        double mb = (double)iters * c->len / (1 << 20);
+        printf("%-14s %12.0f %12.0f\n", c->name, mb / t_print, mb / t_parse);
+
+        free(buf);
+        free(printed);
+        cJSON_Delete(item);
+        free(input);
+    }
+
+    printf("checksum %016lx\n", checksum);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Coherence cost of the worker slots in shm. N processes each update their
+ * own slot the way a worker does around every request (busy, then idle)
+ * while the parent scans all slots like the supervisor. It runs once with
+ * the old packed slots, where neighbours share cache lines, and once with
+ * shm_worker_t as it is now. Both run the same seqlock writes and reads with
+ * the same memory ordering, so the difference is only where the fields sit.
+ * Where perf events are available it also counts the cache misses of all
+ * processes. The effect needs at least as many cores as workers; on fewer,
+ * the processes mostly take turns.
+ *
+ *     bench-shm-slots [workers (32)] [seconds per layout (2)]
+ */
+#define _GNU_SOURCE
+#include <caffeine.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+// shm_worker_t before its hot and cold fields were split onto cache lines of their own,
+// plus the seqlock counter, so both layouts run the same code
+typedef struct {
+    atomic_uint_least32_t   seq;
+    atomic_bool             used;
+    atomic_int              pid;
+    atomic_int              state;
+    atomic_uint_least32_t   handler_idx;
+    atomic_uint_least64_t   start_ms;
+    atomic_uint_least64_t   last_heartbeat;
+    atomic_uint_least64_t   handler_ver;
+    atomic_uint_least32_t   anon_huge_kb;
+    atomic_uint_least32_t   file_huge_kb;
+}   packed_worker_t;
+
+typedef struct {
+    atomic_bool                 stop;
+    packed_worker_t             packed[MAX_WORKERS];
+    shm_worker_t                padded[MAX_WORKERS];
+    _Alignas(SHM_CACHE_LINE) struct {
+        _Alignas(SHM_CACHE_LINE) uint64_t updates;
+    }                           done[MAX_WORKERS];
+}   bench_map_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// cache misses of this process and every child forked after it, -1 without perf
+static int open_miss_counter(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void run_worker(bench_map_t *map, int i, int padded) {
+    uint64_t n = 0;
+    while (!atomic_load_explicit(&map->stop, memory_order_relaxed)) {
+        if (padded) {
+            shm_worker_t *w = &map->padded[i];
+            shm_worker_publish(w, W_BUSY, (uint32_t)n & 1023, n, n);
+            shm_worker_set_state(w, W_IDLE);
+        } else {
+            // the same stores and ordering as shm_worker_publish() and shm_worker_set_state(),
+            // so only the placement of the fields differs
+            packed_worker_t *w = &map->packed[i];
+            uint32_t seq = atomic_load_explicit(&w->seq, memory_order_relaxed);
+            atomic_store_explicit(&w->seq, seq + 1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);
+            atomic_store_explicit(&w->handler_idx, (uint32_t)n & 1023, memory_order_relaxed);
+            atomic_store_explicit(&w->handler_ver, n, memory_order_relaxed);
+            atomic_store_explicit(&w->start_ms, n, memory_order_relaxed);
+            atomic_store_explicit(&w->state, W_BUSY, memory_order_relaxed);
+            atomic_store_explicit(&w->seq, seq + 2, memory_order_release);
+            atomic_store_explicit(&w->state, W_IDLE, memory_order_release);
+        }
+        n++;
+    }
+    map->done[i].updates = n;
+}
+
+// shm_worker_read() on a packed slot
+static int packed_read(packed_worker_t *w, shm_worker_view_t *v) {
+    for (int k = 0; k < SHM_READ_RETRIES; k++) {
+        uint32_t seq = atomic_load_explicit(&w->seq, memory_order_acquire);
+        if (seq & 1) continue;
+        v->state = atomic_load_explicit(&w->state, memory_order_relaxed);
+        v->handler_idx = atomic_load_explicit(&w->handler_idx, memory_order_relaxed);
+        v->handler_ver = atomic_load_explicit(&w->handler_ver, memory_order_relaxed);
+        v->start_ms = atomic_load_explicit(&w->start_ms, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&w->seq, memory_order_relaxed) == seq) return 0;
+    }
+    return -1;
+}
+
+static uint64_t scan(bench_map_t *map, int workers, int padded) {
+    uint64_t busy = 0;
+    for (int i = 0; i < workers; i++) {
+        shm_worker_view_t v;
+        int rc = padded ? shm_worker_read(&map->padded[i], &v) : packed_read(&map->packed[i], &v);
+        if (rc == 0 && v.state == W_BUSY) busy += v.start_ms & 1;
+    }
+    return busy;
+}
+
+static void run_layout(bench_map_t *map, int workers, double seconds, int padded) {
+    int counter = open_miss_counter();
+    atomic_store(&map->stop, 0);
+
+    for (int i = 0; i < workers; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0) {
+            run_worker(map, i, padded);
+            _exit(0);
+        }
+    }
+
+    // the supervisor looks every MONITOR_TICK_MS, scan much more often so its share shows
+    uint64_t sink = 0, scans = 0;
+    double t0 = now_sec();
+    while (now_sec() - t0 < seconds) {
+        sink += scan(map, workers, padded);
+        scans++;
+        usleep(1000);
+    }
+    atomic_store(&map->stop, 1);
+    while (wait(NULL) > 0) {}
+    double elapsed = now_sec() - t0;
+
+    uint64_t total = 0;
+    for (int i = 0; i < workers; i++) total += map->done[i].updates;
+
+    long long misses = -1;
+    if (counter >= 0) {
+        if (read(counter, &misses, sizeof(misses)) != sizeof(misses)) misses = -1;
+        close(counter);
+    }
+
+    printf("%-8s %8zu %14.1f %14.1f %10llu", padded ? "padded" : "packed",
+           padded ? sizeof(shm_worker_t) : sizeof(packed_worker_t),
+           total / elapsed / 1e6, total / elapsed / workers / 1e6, (unsigned long long)scans);
+    if (misses >= 0) printf(" %16.3f\n", (double)misses / total);
+    else printf(" %16s\n", "n/a");
+    (void)sink;
+}
+
+int main(int argc, char **argv) {
+    int workers = argc > 1 ? atoi(argv[1]) : 32;
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    if (workers < 1 || workers > MAX_WORKERS) {
+        fprintf(stderr, "workers must be 1..%d\n", MAX_WORKERS);
+        return 1;
+    }
+
+    bench_map_t *map = mmap(NULL, sizeof(bench_map_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("%d workers, %ld cpus, %.1f s per layout\n", workers, sysconf(_SC_NPROCESSORS_ONLN), seconds);
+    printf("%-8s %8s %14s %14s %10s %16s\n", "layout", "slot B", "M updates/s", "per worker", "scans", "misses/update");
+    run_layout(map, workers, seconds, 0);
+    run_layout(map, workers, seconds, 1);
+    return 0;
+}
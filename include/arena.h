@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_SIZE  (1 << 20) // 1 MiB
+#define ARENA_ALIGN         16
+#define ARENA_HEAD_MAX      (16 << 20) // larger requests keep using overflow chunks
+#define ARENA_DECAY_RESETS  256 // resets under half the peak before it is halved
+
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *next;
+    size_t  size;
+    size_t  used;
+    char    data[];
+}   arena_chunk_t;
+
+/*
+ * Bump allocator reset after every request. The primary chunk is kept
+ * across resets; overflow chunks are released on reset and the primary
+ * chunk is regrown to the observed peak (up to ARENA_HEAD_MAX), so a
+ * steady workload settles on a single chunk and allocation becomes a
+ * pointer bump. The peak decays once requests stay well under it, and the
+ * primary chunk shrinks with it, so one large request does not pin its
+ * memory for the life of the worker.
+ */
+typedef struct {
+    arena_chunk_t *head;
+    arena_chunk_t *extra;
+    void          *last;
+    size_t        peak;
+    size_t        base; // initial size, the primary chunk never shrinks below it
+    unsigned int  quiet; // consecutive resets under half the peak
+}   arena_t;
+
+int arena_init(arena_t *a, size_t size);
+void* arena_alloc(arena_t *a, size_t size);
+char* arena_strndup(arena_t *a, const char *s, size_t len);
+char* arena_strdup(arena_t *a, const char *s);
+void arena_trim(arena_t *a, void *p, size_t used);
+void arena_reset(arena_t *a);
+void arena_prefault(arena_t *a);
+void arena_set_hugepages(int on);
+void arena_destroy(arena_t *a);
+
+#endif
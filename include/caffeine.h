@@ -16,6 +16,9 @@
 #include <arpa/inet.h>
 #include <signal.h>
 #include <shared_mem.h>
+#include <caffeine_handler.h>
+#include <delta.h>
+#include <script_pool.h>
 
 #define SOCKET_PATH "/tmp/"
 #define SOCK_FILE_PREFIX "caffeine_"
@@ -32,7 +35,7 @@ typedef struct headers_s {
     char    query[512];
     char    protocol[16];
     char    headers[8192];
-    char    handler_name[32];
+    char    handler_name[HANDLER_NAME_MAX];
     char    content_type[256];
     char    *headers_end;
     size_t  content_length;
@@ -42,24 +45,49 @@ typedef struct headers_s {
 
 typedef const char* (*handler_func)(const char*, char*, size_t, size_t*);
 
-typedef struct {
+/*
+ * One loaded generation of a handler. The cache holds the current one;
+ * requests take a reference, and a generation replaced while still
+ * referenced is retired and unloaded once the last request is released.
+ */
+typedef struct handler_entry_s {
+    char name[HANDLER_NAME_MAX];
+    uint64_t hash;
     char *path;
-    unsigned long hash;
     void *dl_handle;
+    script_pool_t *script; // interpreters of a .sh/.py handler
     handler_func func;
+    handler_ctx_func ctx_func;
+    handler_batch_func batch_func;
     time_t last_mtime;
     int timeout_ms;
+    const char *raw_content_type;
+    uint8_t is_static;
+    int static_ttl_ms;
+    char *static_resp;
+    size_t static_len;
+    uint64_t static_expires_ms;
+    delta_history_t *delta;
+    uint32_t shm_idx; // registry slot, HANDLER_IDX_NONE when unregistered
+    uint64_t loaded_version;
+    uint32_t refs;
+    uint8_t retired;
+    int so_fd; // held while loaded through /proc/self/fd
+    struct handler_entry_s *next_retired;
 } handler_entry_t;
 
 typedef struct {
-    handler_entry_t *entries;
+    handler_entry_t **slots;
     size_t size;
     size_t capacity;
+    handler_entry_t *retired; // replaced generations still referenced
+    uint32_t reload_delay_ms; // how long this worker keeps a replaced version
 } handler_cache_t;
 
 typedef enum {
     W_IDLE = 'I',
     W_BUSY = 'B',
+    W_WARMUP = 'W', // forked, not accepting yet
     W_EXIT = 'X',
     W_HEARTBEAT = 'H'
 } worker_msg_t;
@@ -17,6 +17,8 @@ typedef struct {
     uint8_t     stop_instance;
     uint8_t     list_instances;
     uint8_t     deploy;
+    uint8_t     preload;
+    uint8_t     hugepages;
     pid_t       *dead_workers;
     int         dead_workers_idx;
     int         listen_fd;
@@ -26,6 +28,7 @@ typedef struct {
     int         current_workers;
     char        *instance_name;
     char        *exec_path;
+    char        *warmup; // handlers loaded before a worker accepts, "*" for all
     char        *log_level;
     char        *socket_path;
     char        *log_path;
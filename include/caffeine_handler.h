@@ -0,0 +1,149 @@
+#ifndef CAFFEINE_HANDLER_H
+#define CAFFEINE_HANDLER_H
+
+/*
+ * Handler-side ABI. A handler exports either the legacy entry point
+ *
+ *     const char* handler(const char *request, char *response_buffer,
+ *                         size_t buffer_size, size_t *result_len);
+ *
+ * or the context-aware one below, which the worker prefers when present:
+ *
+ *     const char* handler_ctx(caffeine_ctx_t *ctx, char *response_buffer,
+ *                             size_t buffer_size, size_t *result_len);
+ *
+ * The request is a NUL-terminated JSON object
+ *
+ *     {"method":"GET","path":"/name?query","handler":"name","headers":"..."}
+ *
+ * where headers holds the raw request head as read from the socket.
+ *
+ * response_buffer starts at 64 KiB and is bounded by guard pages. A handler
+ * whose output does not fit returns NULL with *result_len set to the size it
+ * needs; the worker grows the buffer and calls it again with the same
+ * arguments (up to 64 MiB).
+ *
+ * A handler whose output does not depend on the request can export
+ * `int static_val = 1;` and, optionally, `int static_ttl_val = <ms>;`. The
+ * worker invokes it once, keeps the serialized HTTP response and replays it
+ * with a single write() until the TTL expires or the .so is reloaded.
+ *
+ * By default the handler output is a {"status", "body"} JSON envelope. A
+ * handler that already has the exact body bytes (HTML, protobuf, prebuilt
+ * JSON) calls caffeine_raw(ctx, status, content_type) before returning; the
+ * returned bytes, *result_len of them, are then written unchanged. Legacy
+ * handlers can opt in for every response by exporting
+ * `const char *content_type_val = "text/html";`.
+ *
+ * Handlers serving large, slowly changing JSON objects can export
+ * `int delta_versions_val = <n>;` (at most 16). Each worker then keeps the
+ * last n bodies per path and sends them with an ETag. A client repeating the
+ * ETag in If-None-Match gets a 304 when nothing changed. When it also sends
+ * "A-IM: merge-patch", it gets a 226 with an RFC 7386 merge patch
+ * (application/merge-patch+json) against the version it holds, or the
+ * full 200 when the body holds a null, which a patch cannot carry. The worker
+ * prints the patch into an output buffer of its own (up to 64 MiB); every
+ * other body is written as the handler returned it.
+ *
+ * An exported `void handler_warmup(void)` is called once each time the .so
+ * is loaded, before its first request. Handlers listed in --warmup are
+ * loaded by every new worker before it starts accepting.
+ *
+ * A new version can run next to the current one as name@version.so in the
+ * same directory. It is loaded in a link-map namespace of its own and takes
+ * `int canary_weight_val = <percent>;` (10 when not exported) of the
+ * requests for /name, and can be called directly as /name@version. The
+ * supervisor logs calls, errors and latency of each version every 5 s.
+ *
+ * Bash and Python scripts (name.sh, name.py) are handlers too: each worker
+ * keeps up to 4 interpreters per script running and exchanges length-prefixed
+ * frames with them, see script_pool.h.
+ *
+ * caffeine_json_parse() indexes a JSON text (the request envelope, a body
+ * the handler fetched) into a read-only tape allocated like caffeine_alloc()
+ * memory; see caffeine_json.h for the accessors. It returns 0 or -1 for
+ * invalid JSON.
+ *
+ * Memory obtained with caffeine_alloc() belongs to the worker's per-request
+ * arena: it is valid until the response has been written and must not be
+ * freed by the handler. Fields are only ever appended to caffeine_ctx_t.
+ *
+ * A handler waiting on I/O can suspend instead of blocking the worker: it
+ * calls caffeine_await() with a non-blocking fd, a POLLIN/POLLOUT mask and a
+ * continuation, then returns CAFFEINE_PENDING. The worker keeps serving other
+ * requests and calls the continuation, with the same ctx, once the fd is
+ * ready (ctx->ready_events holds what fired). The fd stays owned by the
+ * handler and only one suspended request can wait on it at a time:
+ * caffeine_await() returns -1 (errno EBUSY) while another one does. If the
+ * handler timeout expires first, the continuation is called once more with
+ * ready_events == 0 so it can release its fd; its result is discarded and
+ * the client gets a 408. response_buffer is only valid for the
+ * duration of a single call, keep state across suspensions in ctx->user or
+ * in caffeine_alloc() memory.
+ *
+ * Tiny handlers can additionally export
+ *
+ *     void handler_batch(caffeine_ctx_t **reqs, size_t n, caffeine_slice_t *resps);
+ *
+ * The worker then hands over every request for that handler that became
+ * ready at once and the handler fills resps[i] with the JSON response for
+ * reqs[i] (static or caffeine_alloc(reqs[i], ...) memory, data == NULL
+ * answers 500). Batched requests cannot suspend.
+ */
+
+#include <stddef.h>
+#include <caffeine_json.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAFFEINE_PENDING ((const char *)-1)
+
+typedef struct caffeine_ctx_s caffeine_ctx_t;
+
+typedef struct {
+    const char  *data;
+    size_t      len;
+}   caffeine_slice_t;
+
+typedef const char* (*caffeine_cont_func)(caffeine_ctx_t*, char*, size_t, size_t*);
+
+struct caffeine_ctx_s {
+    const char  *request;
+    size_t      request_len;
+    void*       (*alloc)(caffeine_ctx_t *ctx, size_t size);
+    void        *priv;
+    int         (*await)(caffeine_ctx_t *ctx, int fd, unsigned int events, caffeine_cont_func cont);
+    void        *user;
+    unsigned int ready_events;
+    int         raw_status;
+    const char  *raw_content_type;
+    int         (*json_parse)(caffeine_ctx_t *ctx, const char *json, size_t len, caffeine_json_t *doc);
+};
+
+typedef const char* (*handler_ctx_func)(caffeine_ctx_t*, char*, size_t, size_t*);
+typedef void (*handler_batch_func)(caffeine_ctx_t**, size_t, caffeine_slice_t*);
+
+static inline void* caffeine_alloc(caffeine_ctx_t *ctx, size_t size) {
+    return ctx->alloc(ctx, size);
+}
+
+static inline void caffeine_raw(caffeine_ctx_t *ctx, int status, const char *content_type) {
+    ctx->raw_status = status;
+    ctx->raw_content_type = content_type;
+}
+
+static inline int caffeine_json_parse(caffeine_ctx_t *ctx, const char *json, size_t len, caffeine_json_t *doc) {
+    return ctx->json_parse(ctx, json, len, doc);
+}
+
+static inline int caffeine_await(caffeine_ctx_t *ctx, int fd, unsigned int events, caffeine_cont_func cont) {
+    return ctx->await(ctx, fd, events, cont);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef CAFFEINE_JSON_H
+#define CAFFEINE_JSON_H
+
+/*
+ * Read-only JSON document stored as one contiguous tape, built in a single
+ * pass by caffeine_json_parse(). Every value is one node in document order
+ * and points back into the source text, nothing is copied or decoded until
+ * asked for. Members of an object are stored as key, value, key, value...
+ * and node.next jumps over a whole subtree, so walking the children of a
+ * container never descends into them:
+ *
+ *     for (uint32_t i = caffeine_json_first(doc, obj); i != CAFFEINE_JSON_NONE;
+ *          i = caffeine_json_next(doc, obj, caffeine_json_next(doc, obj, i)))
+ *         key i, value i + 1
+ *
+ * The source text must outlive the document.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAFFEINE_JSON_NONE ((uint32_t)-1)
+
+typedef enum {
+    CAFFEINE_JSON_NULL = 1,
+    CAFFEINE_JSON_FALSE,
+    CAFFEINE_JSON_TRUE,
+    CAFFEINE_JSON_NUMBER,
+    CAFFEINE_JSON_STRING,
+    CAFFEINE_JSON_ARRAY,
+    CAFFEINE_JSON_OBJECT
+}   caffeine_json_type_t;
+
+#define CAFFEINE_JSON_TYPE_MASK 0x0f
+#define CAFFEINE_JSON_ESCAPED   0x10 // string contains escape sequences
+
+typedef struct {
+    uint32_t    offset; // first byte of the value in the source
+    uint32_t    len;    // bytes of the value, quotes and brackets included
+    uint32_t    next;   // index of the node following this subtree
+    uint32_t    flags;
+}   caffeine_json_node_t;
+
+typedef struct {
+    const char              *src;
+    size_t                  src_len;
+    caffeine_json_node_t    *nodes;
+    uint32_t                count;
+}   caffeine_json_t;
+
+static inline caffeine_json_type_t caffeine_json_type(const caffeine_json_t *doc, uint32_t i) {
+    return (caffeine_json_type_t)(doc->nodes[i].flags & CAFFEINE_JSON_TYPE_MASK);
+}
+
+// raw bytes of any value, e.g. to forward a sub-object untouched
+static inline const char* caffeine_json_raw(const caffeine_json_t *doc, uint32_t i, size_t *len) {
+    *len = doc->nodes[i].len;
+    return doc->src + doc->nodes[i].offset;
+}
+
+static inline uint32_t caffeine_json_first(const caffeine_json_t *doc, uint32_t container) {
+    return doc->nodes[container].next > container + 1 ? container + 1 : CAFFEINE_JSON_NONE;
+}
+
+static inline uint32_t caffeine_json_next(const caffeine_json_t *doc, uint32_t container, uint32_t i) {
+    uint32_t n = doc->nodes[i].next;
+    return n < doc->nodes[container].next ? n : CAFFEINE_JSON_NONE;
+}
+
+// elements of an array, members of an object
+static inline size_t caffeine_json_size(const caffeine_json_t *doc, uint32_t container) {
+    size_t n = 0;
+    for (uint32_t i = caffeine_json_first(doc, container); i != CAFFEINE_JSON_NONE; i = caffeine_json_next(doc, container, i)) n++;
+    return caffeine_json_type(doc, container) == CAFFEINE_JSON_OBJECT ? n / 2 : n;
+}
+
+static inline uint32_t caffeine_json_at(const caffeine_json_t *doc, uint32_t array, size_t idx) {
+    uint32_t i = caffeine_json_first(doc, array);
+    while (i != CAFFEINE_JSON_NONE && idx--) i = caffeine_json_next(doc, array, i);
+    return i;
+}
+
+// string contents without the quotes, still escaped when CAFFEINE_JSON_ESCAPED is set
+static inline const char* caffeine_json_str(const caffeine_json_t *doc, uint32_t i, size_t *len) {
+    *len = doc->nodes[i].len - 2;
+    return doc->src + doc->nodes[i].offset + 1;
+}
+
+// value of the first member called key (compared as written in the source), or CAFFEINE_JSON_NONE
+static inline uint32_t caffeine_json_get(const caffeine_json_t *doc, uint32_t obj, const char *key) {
+    size_t key_len = strlen(key);
+    if (caffeine_json_type(doc, obj) != CAFFEINE_JSON_OBJECT) return CAFFEINE_JSON_NONE;
+
+    for (uint32_t k = caffeine_json_first(doc, obj); k != CAFFEINE_JSON_NONE; k = caffeine_json_next(doc, obj, k + 1)) {
+        size_t len;
+        const char *s = caffeine_json_str(doc, k, &len);
+        if (len == key_len && !memcmp(s, key, len)) return k + 1;
+    }
+    return CAFFEINE_JSON_NONE;
+}
+
+static inline double caffeine_json_double(const caffeine_json_t *doc, uint32_t i) {
+    char num[64];
+    size_t len = doc->nodes[i].len;
+    if (caffeine_json_type(doc, i) != CAFFEINE_JSON_NUMBER) return 0;
+    if (len >= sizeof(num)) len = sizeof(num) - 1;
+    memcpy(num, doc->src + doc->nodes[i].offset, len);
+    num[len] = 0;
+    return strtod(num, NULL);
+}
+
+static inline int caffeine_json_bool(const caffeine_json_t *doc, uint32_t i) {
+    return caffeine_json_type(doc, i) == CAFFEINE_JSON_TRUE;
+}
+
+static inline unsigned long caffeine_json_hex4(const char *s) {
+    unsigned long v = 0;
+    for (int k = 0; k < 4; k++) {
+        char c = s[k];
+        v = (v << 4) | (unsigned long)(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    return v;
+}
+
+/*
+ * Decodes string node i into dst, which needs room for the escaped length
+ * (caffeine_json_str() len) plus a NUL. Returns the decoded length.
+ */
+static inline size_t caffeine_json_unescape(const caffeine_json_t *doc, uint32_t i, char *dst) {
+    size_t len;
+    const char *s = caffeine_json_str(doc, i, &len);
+    const char *end = s + len;
+    char *out = dst;
+
+    if (!(doc->nodes[i].flags & CAFFEINE_JSON_ESCAPED)) {
+        memcpy(dst, s, len);
+        dst[len] = 0;
+        return len;
+    }
+
+    while (s < end) {
+        if (*s != '\\') {
+            *out++ = *s++;
+            continue;
+        }
+        s++;
+        switch (*s++) {
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                unsigned long cp = caffeine_json_hex4(s);
+                s += 4;
+                if (cp >= 0xd800 && cp <= 0xdbff && end - s >= 6 && s[0] == '\\' && s[1] == 'u') {
+                    unsigned long lo = caffeine_json_hex4(s + 2);
+                    if (lo >= 0xdc00 && lo <= 0xdfff) {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                        s += 6;
+                    }
+                }
+                // an unpaired surrogate has no UTF-8 form, U+FFFD stands in for it
+                if (cp >= 0xd800 && cp <= 0xdfff) cp = 0xfffd;
+                if (cp < 0x80) {
+                    *out++ = (char)cp;
+                } else if (cp < 0x800) {
+                    *out++ = (char)(0xc0 | (cp >> 6));
+                    *out++ = (char)(0x80 | (cp & 0x3f));
+                } else if (cp < 0x10000) {
+                    *out++ = (char)(0xe0 | (cp >> 12));
+                    *out++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+                    *out++ = (char)(0x80 | (cp & 0x3f));
+                } else {
+                    *out++ = (char)(0xf0 | (cp >> 18));
+                    *out++ = (char)(0x80 | ((cp >> 12) & 0x3f));
+                    *out++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+                    *out++ = (char)(0x80 | (cp & 0x3f));
+                }
+                break;
+            }
+            default: *out++ = s[-1]; break; // \" \\ and \/
+        }
+    }
+    *out = 0;
+    return out - dst;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,6 +5,10 @@
 #include <pthread.h>
 #include <shared_mem.h>
 
+#define MONITOR_TICK_MS 250
+#define MONITOR_SCALE_TICKS 20 // scale every 5 seconds
+#define WARMUP_TIMEOUT_MS 30000
+
 typedef struct {
     unsigned long utime;
     unsigned long stime;
@@ -13,7 +13,10 @@ char* get_default_path();
 void list_running_instances();
 char *find_headers_end(const char *__haystack, const char *__needle, size_t size);
 ssize_t write_fully(int fd, const char *buf, size_t count);
+ssize_t writev_fully(int fd, struct iovec *iov, int iovcnt);
 unsigned long hash_path(const char *str);
+uint64_t hash_name(const char *str, size_t len);
 uint64_t now_ms(void);
+uint64_t now_us(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_MAX_VERSIONS  16
+#define DELTA_MAX_KEYS      64
+
+typedef struct {
+    uint64_t    etag;
+    char        *json;
+    size_t      len;
+}   delta_version_t;
+
+typedef struct {
+    uint64_t        key;
+    uint64_t        last_used;
+    size_t          head;
+    size_t          count;
+    delta_version_t versions[DELTA_MAX_VERSIONS];
+}   delta_key_t;
+
+/*
+ * Last response bodies of a handler that exports delta_versions_val, kept
+ * per worker and per request path (query included). Each key holds a ring
+ * of up to max_versions bodies; when every key is taken the least recently
+ * used one is recycled.
+ */
+typedef struct {
+    int         max_versions;
+    size_t      nkeys;
+    uint64_t    tick;
+    delta_key_t keys[DELTA_MAX_KEYS];
+}   delta_history_t;
+
+delta_history_t* delta_history_new(int max_versions);
+void delta_history_free(delta_history_t *h);
+uint64_t delta_hash(const char *data, size_t len);
+const delta_version_t* delta_find(delta_history_t *h, uint64_t key, uint64_t etag);
+int delta_record(delta_history_t *h, uint64_t key, uint64_t etag, const char *body, size_t len);
+
+#endif
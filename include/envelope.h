@@ -0,0 +1,45 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <caffeine.h>
+#include <arena.h>
+#include <stddef.h>
+
+#define ENVELOPE_SLOW_PATH 1
+
+/*
+ * Result of a single pass over a {"status": <int>, "body": <value>} handler
+ * response. body points into the scanned buffer: objects, arrays, numbers
+ * and literals are the raw value bytes, strings are the bytes between the
+ * quotes. A missing body is reported as an empty slice.
+ */
+typedef struct {
+    int         status;
+    const char  *body;
+    size_t      body_len;
+    int         body_is_string;
+}   envelope_t;
+
+/*
+ * Returns 0 on success, -1 when the buffer is not a JSON object and
+ * ENVELOPE_SLOW_PATH when the envelope is valid but needs a real parser
+ * (a body string or a member name containing escape sequences).
+ */
+int envelope_scan(const char *json, size_t len, envelope_t *env);
+
+/*
+ * Slow path for ENVELOPE_SLOW_PATH: indexes the whole response on a JSON
+ * tape and decodes an escaped body string into arena. Returns 0 or -1.
+ */
+int envelope_decode(arena_t *arena, const char *json, size_t len, envelope_t *env);
+
+/*
+ * Request envelope handed to handlers:
+ *     {"method":"...","path":"...","handler":"...","headers":"..."}
+ * envelope_request_max() is an upper bound for envelope_write_request(),
+ * which returns the length written, not counting the terminating NUL.
+ */
+size_t envelope_request_max(const headers_t *hdrs);
+size_t envelope_write_request(char *dst, const headers_t *hdrs);
+
+#endif
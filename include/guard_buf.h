@@ -0,0 +1,29 @@
+#ifndef GUARD_BUF_H
+#define GUARD_BUF_H
+
+#include <stddef.h>
+
+#define GUARD_BUF_DEFAULT_SIZE  (64 * 1024)        // 64 KiB
+#define GUARD_BUF_MAX_SIZE      (64 * 1024 * 1024) // 64 MiB
+
+/*
+ * Growable buffer living in a reserved mmap region. The pages before and
+ * after the usable area are PROT_NONE, so an overrun faults instead of
+ * silently corrupting the worker. Growing only changes page protections,
+ * the base address never moves.
+ */
+typedef struct {
+    char    *base;
+    size_t  cap;
+    size_t  min_cap;
+    size_t  max_cap;
+    size_t  reserved;
+}   guard_buf_t;
+
+int guard_buf_init(guard_buf_t *b, size_t cap, size_t max_cap);
+int guard_buf_grow(guard_buf_t *b, size_t need);
+void guard_buf_shrink(guard_buf_t *b);
+void guard_buf_prefault(guard_buf_t *b);
+void guard_buf_destroy(guard_buf_t *b);
+
+#endif
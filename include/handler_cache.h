@@ -0,0 +1,17 @@
+#ifndef HANDLER_CACHE_H
+#define HANDLER_CACHE_H
+
+#include <caffeine.h>
+
+#define HANDLER_CACHE_MIN_CAPACITY 64
+
+/*
+ * Open-addressing table of handler entries, linear probing on hash_name().
+ * Entries are allocated one by one and never move, so pointers to them stay
+ * valid while the table grows; a lookup always confirms the name.
+ */
+handler_entry_t* handler_cache_find(handler_cache_t *cache, const char *name, uint64_t hash);
+handler_entry_t* handler_cache_insert(handler_cache_t *cache, const char *name, uint64_t hash);
+handler_entry_t* handler_cache_retire(handler_cache_t *cache, handler_entry_t *entry);
+
+#endif
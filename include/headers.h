@@ -4,5 +4,6 @@
 #include <caffeine.h>
 
 int read_headers(int client_fd, headers_t *hdrs);
+const char* find_header(const char *headers, const char *name, size_t *len);
 
 #endif
\ No newline at end of file
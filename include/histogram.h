@@ -0,0 +1,79 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*
+ * Log-linear histogram in the style of HdrHistogram. Values below
+ * HIST_SUB get a bucket each; every power of two above that is split into
+ * HIST_SUB equal buckets, so a bucket is at most 1/8 of the values it holds
+ * wide (12.5% relative error) and 240 buckets cover up to 2^32 (71 minutes
+ * in microseconds).
+ *
+ * Every histogram in shm has a single writing process, which updates it
+ * with hist_record(), a relaxed load and store per value and no locked
+ * instruction. Readers copy the buckets with hist_snapshot() and take the
+ * count from the copy, so every figure derived from one snapshot agrees
+ * with the others; histograms of several writers are added up with
+ * hist_merge().
+ */
+#define HIST_SUB_BITS 3
+#define HIST_SUB (1u << HIST_SUB_BITS)
+#define HIST_MAX_EXP 32
+#define HIST_BUCKETS ((HIST_MAX_EXP - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    atomic_uint_least64_t buckets[HIST_BUCKETS];
+}   hist_t;
+
+typedef struct {
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count;
+}   hist_snapshot_t;
+
+static inline uint32_t hist_bucket(uint64_t v) {
+    if (v < HIST_SUB) return (uint32_t)v;
+    uint32_t exp = 63 - __builtin_clzll(v);
+    if (exp >= HIST_MAX_EXP) return HIST_BUCKETS - 1;
+    return (exp - HIST_SUB_BITS + 1) * HIST_SUB + (uint32_t)((v >> (exp - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+// single writer only
+static inline void hist_record(hist_t *h, uint64_t v) {
+    atomic_uint_least64_t *b = &h->buckets[hist_bucket(v)];
+    atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+/*
+ * Coarse variant for where there are many histograms, such as one per
+ * worker slot and handler: two buckets per power of two (up to 50%
+ * relative error), 64 in all over the same range. Readers fold it into a
+ * hist_snapshot_t with hist_coarse_merge() and use the functions below.
+ */
+#define HIST_COARSE_BUCKETS 64
+
+typedef struct {
+    atomic_uint_least64_t buckets[HIST_COARSE_BUCKETS];
+}   hist_coarse_t;
+
+static inline uint32_t hist_coarse_bucket(uint64_t v) {
+    if (v < 2) return (uint32_t)v;
+    uint32_t exp = 63 - __builtin_clzll(v);
+    if (exp >= HIST_MAX_EXP) return HIST_COARSE_BUCKETS - 1;
+    return exp * 2 + (uint32_t)((v >> (exp - 1)) & 1);
+}
+
+// single writer only
+static inline void hist_coarse_record(hist_coarse_t *h, uint64_t v) {
+    atomic_uint_least64_t *b = &h->buckets[hist_coarse_bucket(v)];
+    atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+void hist_coarse_merge(hist_snapshot_t *into, const hist_coarse_t *h);
+void hist_snapshot(const hist_t *h, hist_snapshot_t *out);
+void hist_delta(const hist_snapshot_t *now, const hist_snapshot_t *before, hist_snapshot_t *out);
+void hist_merge(hist_snapshot_t *into, const hist_snapshot_t *from);
+uint64_t hist_percentile(const hist_snapshot_t *s, double p);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef HUGEPAGE_H
+#define HUGEPAGE_H
+
+#include <stddef.h>
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*
+ * Transparent huge page helpers behind --hugepages. All of it is advice:
+ * with THP disabled, or a kernel without file-backed THP, the calls fail
+ * quietly and memory stays on base pages. Prefaulting still applies.
+ */
+void hugepage_advise(void *addr, size_t len);
+void* hugepage_alloc(size_t len);
+int hugepage_text(void *dl_handle);
+int hugepage_usage(size_t *anon_kb, size_t *file_kb);
+
+#endif
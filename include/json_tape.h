@@ -0,0 +1,16 @@
+#ifndef JSON_TAPE_H
+#define JSON_TAPE_H
+
+#include <arena.h>
+#include <caffeine_json.h>
+
+#define JSON_TAPE_MAX_DEPTH 1000
+
+/*
+ * Validates json and indexes it into doc, with the tape taken from arena.
+ * Returns 0, or -1 when the text is not a single valid JSON value (trailing
+ * whitespace allowed) or the tape cannot be allocated.
+ */
+int json_tape_build(arena_t *arena, const char *json, size_t len, caffeine_json_t *doc);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SCRIPT_POOL_H
+#define SCRIPT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <caffeine_handler.h>
+
+#define SCRIPT_POOL_MAX 4                   // interpreters per script per worker
+#define SCRIPT_INLINE_MAX (60 * 1024)       // larger frames go through the shared region
+#define SCRIPT_BODY_MAX (64 * 1024 * 1024)
+
+/*
+ * Script handlers (.sh, .py) run in interpreters that each worker starts on
+ * first use and keeps, so a request costs two pipe writes instead of a
+ * fork and an interpreter startup. Frames in both directions are
+ *
+ *     <length>[ <status>]\n<payload>
+ *
+ * where the request payload is the JSON envelope handed to .so handlers and
+ * the response payload is the body, sent as application/json with status
+ * (200 when omitted). A payload over SCRIPT_INLINE_MAX is written at offset
+ * 0 of the memfd the interpreter has on fd 3 instead, and its frame is
+ * "@<length>[ <status>]\n" with nothing after it.
+ */
+typedef struct {
+    pid_t       pid;        // 0 when not running
+    int         in_fd;      // interpreter stdin
+    int         out_fd;     // interpreter stdout, non-blocking
+    int         shm_fd;     // the interpreter's fd 3
+    uint8_t     busy;
+    char        hdr[32];    // response frame being read
+    size_t      hdr_len;
+    char        *body;
+    size_t      body_len;
+    size_t      got;
+    int         status;
+}   script_proc_t;
+
+typedef struct {
+    char            *path;
+    const char      *interp;
+    script_proc_t   procs[SCRIPT_POOL_MAX];
+}   script_pool_t;
+
+int script_is_name(const char *name);
+script_pool_t* script_pool_new(const char *path);
+void script_pool_free(script_pool_t *pool);
+const char* script_call(caffeine_ctx_t *ctx, script_pool_t *pool, char *buf, size_t cap, size_t *len);
+
+#endif
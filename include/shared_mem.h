@@ -1,40 +1,196 @@
 #ifndef SHARED_MEM_H
 #define SHARED_MEM_H
 
-#define MAX_HANDLERS 128
+#define MAX_HANDLERS 1024
 #define MAX_WORKERS  64
+#define HANDLER_NAME_MAX 32
+#define HANDLER_INDEX_SIZE (MAX_HANDLERS * 2) // power of two, at most half full
+#define HANDLER_IDX_NONE UINT32_MAX
+#define HANDLER_DEFAULT_TIMEOUT_MS 5000
+#define HANDLER_RELOAD_STAGGER_MS 20 // per worker slot, spreads a deploy's reloads
+#define HANDLER_MAX_CANARIES 4 // name@version handlers routed from one name
+#define HANDLER_MAX_NAMESPACES 8 // dlmopen namespaces a worker spends on canaries, see load_handler()
+#define CANARY_DEFAULT_WEIGHT 10 // percent, when the .so exports no canary_weight_val
+#define SHM_CACHE_LINE 64
 
 #include <stddef.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <stdatomic.h>
+#include <histogram.h>
 
+/*
+ * One registered handler. The supervisor is the only writer of name,
+ * so_path and hash: they are filled in before the slot is published in
+ * shm_layout_t.index and never change afterwards, so readers need no lock.
+ * version moves every time the .so is created, replaced or removed and
+ * present tells whether it currently exists.
+ *
+ * A file called name@version.so registers as its own handler and, while
+ * it exists, is also listed in canaries[] of name, which hands it weight
+ * percent of the requests for name. Weights that add up to more than 100
+ * are scaled down so the canaries share all of them.
+ *
+ * What a handler's calls did is counted per worker slot, in
+ * shm_layout_t.handler_stats, so every version has its own figures and no
+ * worker ever writes a line another one does. timeout_kills is only
+ * written by the supervisor and sits on a line of its own, away from the
+ * fields workers read on each request.
+ */
 typedef struct {
-    atomic_char           so_path[512];
-    atomic_uint_least32_t timeout_ms;
+    char                  name[HANDLER_NAME_MAX];
+    char                  so_path[512];
+    atomic_uint_least32_t timeout_ms; // refreshed by workers from timeout_val on load
     atomic_uint_least64_t hash;
     atomic_uint_least64_t version;
+    atomic_uint_least64_t changed_ms; // when version last moved
+    atomic_bool           present;
+    atomic_uint_least32_t weight;
+    atomic_uint_least32_t canary_count;
+    atomic_uint_least32_t canaries[HANDLER_MAX_CANARIES];
+    _Alignas(SHM_CACHE_LINE) atomic_uint_least64_t timeout_kills; // workers killed by the supervisor while running it
 } shm_handler_t;
 
+/*
+ * One worker slot, on cache lines no other slot touches. The first holds
+ * what the worker writes around every request; state, handler_idx,
+ * handler_ver and start_ms change together under seq, a seqlock whose only
+ * writer is the worker (shm_worker_publish()). The supervisor reads them
+ * with shm_worker_read(). The second line changes only when the slot is
+ * claimed or released by the supervisor, after a handler load, or when the
+ * supervisor kills the worker over a handler timeout.
+ */
 typedef struct {
-    atomic_bool             used;
-    atomic_int              pid;
+    _Alignas(SHM_CACHE_LINE) atomic_uint_least32_t seq; // odd while an update is under way
     atomic_int              state;
-    atomic_uint_least8_t    handler_idx;
+    atomic_uint_least32_t   handler_idx; // valid while state is W_BUSY
     atomic_uint_least64_t   start_ms;
-    atomic_uint_least64_t   last_heartbeat;
     atomic_uint_least64_t   handler_ver;
+
+    _Alignas(SHM_CACHE_LINE) atomic_bool used;
+    atomic_int              pid;
+    atomic_uint_least32_t   anon_huge_kb; // with --hugepages, refreshed after loads
+    atomic_uint_least32_t   file_huge_kb;
+    atomic_uint_least64_t   timeout_kills; // kept across respawns, like shm_worker_stats_t
 } shm_worker_t;
 
+typedef struct {
+    int         state;
+    uint32_t    handler_idx;
+    uint64_t    start_ms;
+    uint64_t    handler_ver;
+}   shm_worker_view_t;
+
+#define SHM_READ_RETRIES 64
+
+// worker only
+static inline void shm_worker_publish(shm_worker_t *w, int state, uint32_t handler_idx, uint64_t handler_ver, uint64_t start_ms) {
+    uint32_t seq = atomic_load_explicit(&w->seq, memory_order_relaxed);
+    atomic_store_explicit(&w->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&w->handler_idx, handler_idx, memory_order_relaxed);
+    atomic_store_explicit(&w->handler_ver, handler_ver, memory_order_relaxed);
+    atomic_store_explicit(&w->start_ms, start_ms, memory_order_relaxed);
+    atomic_store_explicit(&w->state, state, memory_order_relaxed);
+    atomic_store_explicit(&w->seq, seq + 2, memory_order_release);
+}
+
+// a state change alone needs no snapshot, the other fields only matter while busy
+static inline void shm_worker_set_state(shm_worker_t *w, int state) {
+    atomic_store_explicit(&w->state, state, memory_order_release);
+}
+
+/*
+ * Consistent copy of the fields shm_worker_publish() writes. Returns -1
+ * when no stable copy was seen within SHM_READ_RETRIES attempts, e.g. the
+ * worker died half way through an update.
+ */
+static inline int shm_worker_read(const shm_worker_t *w, shm_worker_view_t *v) {
+    for (int k = 0; k < SHM_READ_RETRIES; k++) {
+        uint32_t seq = atomic_load_explicit(&w->seq, memory_order_acquire);
+        if (seq & 1) continue;
+        v->state = atomic_load_explicit(&w->state, memory_order_relaxed);
+        v->handler_idx = atomic_load_explicit(&w->handler_idx, memory_order_relaxed);
+        v->handler_ver = atomic_load_explicit(&w->handler_ver, memory_order_relaxed);
+        v->start_ms = atomic_load_explicit(&w->start_ms, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&w->seq, memory_order_relaxed) == seq) return 0;
+    }
+    return -1;
+}
+
+/*
+ * Traffic counters of one worker slot, on cache lines of their own so a
+ * worker updating them never contends with its neighbours. The worker is
+ * the only writer (shm_counter_add()); what the supervisor counts for a
+ * slot lives in shm_worker_t. They survive respawns: a slot's figures cover
+ * every worker that has run in it.
+ */
+typedef struct {
+    atomic_uint_least64_t   requests;
+    atomic_uint_least64_t   bytes_in;
+    atomic_uint_least64_t   bytes_out;
+    atomic_uint_least64_t   status[5]; // 1xx to 5xx
+    atomic_uint_least64_t   parse_errors; // requests dropped before a handler was picked
+    atomic_uint_least64_t   timeouts; // suspended requests answered with a 408
+    hist_t                  latency_us;
+} __attribute__((aligned(SHM_CACHE_LINE))) shm_worker_stats_t;
+
+/*
+ * What one worker slot's calls of one handler did, written by that worker
+ * only (shm_counter_add(), hist_coarse_record()). The supervisor adds the
+ * slots up for its reports. cpu_ns is the worker thread's CPU time spent in
+ * the handler; an interpreter's own CPU time is not included.
+ *
+ * There is a row per slot a worker can have (g_cfg.max_workers) and
+ * handler, mapped apart from shm_layout_t with MAP_NORESERVE once the
+ * configuration is known. The latency histograms are coarse and kept apart
+ * from the counters, so scanning the counters does not fault in histogram
+ * pages no worker has written.
+ */
+typedef struct {
+    atomic_uint_least64_t   calls;
+    atomic_uint_least64_t   errors; // answered with a 5xx
+    atomic_uint_least64_t   latency_us; // summed over calls
+    atomic_uint_least64_t   cpu_ns;
+    atomic_uint_least64_t   bytes_out;
+} shm_handler_stats_t;
+
+static inline void shm_counter_add(atomic_uint_least64_t *c, uint64_t n) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
 typedef struct shm_layout_s {
     uint32_t handler_count;
+    atomic_bool watched; // exec_path is watched, versions are authoritative
+    atomic_uint_least32_t index[HANDLER_INDEX_SIZE]; // name hash -> handler slot + 1, 0 is empty
     shm_handler_t handlers[MAX_HANDLERS];
 
     uint32_t worker_count;
     shm_worker_t  workers[MAX_WORKERS];
+    shm_worker_stats_t stats[MAX_WORKERS];
+
+    // [worker slot][handler] for stats_slots slots, see shm_handler_stats_t
+    uint32_t stats_slots;
+    shm_handler_stats_t *handler_stats;
+    hist_coarse_t *handler_latency; // microseconds
 }   shm_layout_t;
 
+static inline shm_handler_stats_t *shm_handler_stats(shm_layout_t *map, uint32_t slot, uint32_t idx) {
+    return &map->handler_stats[(size_t)slot * MAX_HANDLERS + idx];
+}
+
+static inline hist_coarse_t *shm_handler_latency(shm_layout_t *map, uint32_t slot, uint32_t idx) {
+    return &map->handler_latency[(size_t)slot * MAX_HANDLERS + idx];
+}
+
 // Prototypes
 void* create_shared_map();
+int registry_lookup(shm_layout_t *map, const char *name, uint64_t hash);
+int registry_watch(shm_layout_t *map);
+void registry_handle_events(int fd, shm_layout_t *map);
+void registry_release_preloaded(uint32_t idx, uint64_t version);
+void registry_report_canaries(shm_layout_t *map);
+void registry_report_handlers(shm_layout_t *map, uint64_t interval_ms);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,137 @@
+#include <arena.h>
+#include <hugepage.h>
+#include <log.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ALIGN_UP(n, a) (((n) + ((a) - 1)) & ~((size_t)(a) - 1))
+
+static int use_hugepages = 0;
+
+// chunks are then whole, aligned huge pages
+void arena_set_hugepages(int on) {
+    use_hugepages = on;
+}
+
+static arena_chunk_t* chunk_new(size_t size) {
+    size_t page = use_hugepages ? HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+    size_t total = ALIGN_UP(sizeof(arena_chunk_t) + size, page);
+
+    arena_chunk_t *c = use_hugepages ? hugepage_alloc(total)
+                                     : mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (!c || c == MAP_FAILED) {
+        LOG_ERROR("arena: mmap of %zu bytes failed: %s", total, strerror(errno));
+        return NULL;
+    }
+    c->next = NULL;
+    c->size = total - sizeof(arena_chunk_t);
+    c->used = 0;
+    return c;
+}
+
+static void chunk_free(arena_chunk_t *c) {
+    munmap(c, sizeof(arena_chunk_t) + c->size);
+}
+
+int arena_init(arena_t *a, size_t size) {
+    memset(a, 0, sizeof(arena_t));
+    a->base = size ? size : ARENA_DEFAULT_SIZE;
+    a->head = chunk_new(a->base);
+    return a->head ? 0 : -1;
+}
+
+void* arena_alloc(arena_t *a, size_t size) {
+    size = ALIGN_UP(size ? size : 1, ARENA_ALIGN);
+
+    arena_chunk_t *c = a->extra ? a->extra : a->head;
+    if (c && c->size - c->used >= size) {
+        void *p = c->data + c->used;
+        c->used += size;
+        a->last = p;
+        return p;
+    }
+
+    size_t want = (c && c->size * 2 > size) ? c->size * 2 : size;
+    arena_chunk_t *n = chunk_new(want);
+    if (!n) return NULL;
+
+    n->next = a->extra;
+    a->extra = n;
+    n->used = size;
+    a->last = n->data;
+    return n->data;
+}
+
+char* arena_strndup(arena_t *a, const char *s, size_t len) {
+    char *p = arena_alloc(a, len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = 0;
+    return p;
+}
+
+char* arena_strdup(arena_t *a, const char *s) {
+    return arena_strndup(a, s, strlen(s));
+}
+
+// gives back the unused tail of p when it is the most recent allocation
+void arena_trim(arena_t *a, void *p, size_t used) {
+    arena_chunk_t *c = a->extra ? a->extra : a->head;
+    if (!c || p != a->last) return;
+
+    size_t end = ALIGN_UP((size_t)((char *)p - c->data) + (used ? used : 1), ARENA_ALIGN);
+    if (end < c->used) c->used = end;
+}
+
+// faults in the primary chunk, which every request allocates from
+void arena_prefault(arena_t *a) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    arena_chunk_t *c = a->head;
+    if (!c) return;
+
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(c, sizeof(arena_chunk_t) + c->size, MADV_POPULATE_WRITE) == 0) return;
+#endif
+    for (size_t off = 0; off < c->size; off += page) ((volatile char *)c->data)[off] = 0;
+}
+
+void arena_reset(arena_t *a) {
+    if (!a->head) return;
+
+    size_t used = a->head->used;
+    while (a->extra) {
+        arena_chunk_t *next = a->extra->next;
+        used += a->extra->used;
+        chunk_free(a->extra);
+        a->extra = next;
+    }
+    if (used > a->peak) {
+        a->peak = used;
+        a->quiet = 0;
+    } else if (used > a->peak / 2) {
+        a->quiet = 0;
+    } else if (++a->quiet >= ARENA_DECAY_RESETS) {
+        a->peak /= 2;
+        a->quiet = 0;
+    }
+
+    size_t want = a->peak > ARENA_HEAD_MAX ? ARENA_HEAD_MAX : a->peak;
+    if (want < a->base) want = a->base;
+    // grow to the peak, shrink only once it is well below the chunk
+    if (want > a->head->size || a->head->size >= 2 * want) {
+        arena_chunk_t *resized = chunk_new(want);
+        if (resized) {
+            chunk_free(a->head);
+            a->head = resized;
+        }
+    }
+    a->head->used = 0;
+    a->last = NULL;
+}
+
+void arena_destroy(arena_t *a) {
+    arena_reset(a);
+    if (a->head) chunk_free(a->head);
+    memset(a, 0, sizeof(arena_t));
+}
@@ -815,6 +815,223 @@ fail:
     return 0;
 }
 
+/* Scanning of string runs that need no escaping, 16 or 32 bytes at a time.
+ * AVX2 is picked at runtime when the CPU has it, SSE2 otherwise, NEON on
+ * aarch64. Every variant stops at the same byte as the plain loop; define
+ * CJSON_NO_SIMD to build with the plain loop only. */
+#if !defined(CJSON_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CJSON_SIMD_X86
+#include <immintrin.h>
+#elif !defined(CJSON_NO_SIMD) && defined(__GNUC__) && defined(__aarch64__)
+#define CJSON_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(CJSON_SIMD_X86) || defined(CJSON_SIMD_NEON)
+/* aligned loads may read past the terminator within the same page, which is
+ * safe but reported by AddressSanitizer */
+#define CJSON_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+
+#if !defined(CJSON_SIMD_X86)
+/* first byte that is a quote, a backslash or below 32 (the terminating NUL included) */
+static const unsigned char *skip_plain_scalar(const unsigned char *input)
+{
+    while ((*input > 31) && (*input != '\"') && (*input != '\\'))
+    {
+        input++;
+    }
+    return input;
+}
+#endif
+
+/* first quote or backslash before end */
+static const unsigned char *skip_unescaped_scalar(const unsigned char *input, const unsigned char * const end)
+{
+    while ((input < end) && (*input != '\"') && (*input != '\\'))
+    {
+        input++;
+    }
+    return input;
+}
+
+#if defined(CJSON_SIMD_X86)
+static int cpu_has_avx2(void)
+{
+    static int avx2 = -1;
+    if (avx2 < 0)
+    {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return avx2;
+}
+
+/* the input is only NUL terminated, so loads are aligned and never cross into the next page */
+CJSON_NO_ASAN
+static const unsigned char *skip_plain_sse2(const unsigned char *input)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(31);
+
+    while (((size_t)input & 15) != 0)
+    {
+        if ((*input < 32) || (*input == '\"') || (*input == '\\'))
+        {
+            return input;
+        }
+        input++;
+    }
+    for (;;)
+    {
+        __m128i chunk = _mm_load_si128((const __m128i*)(const void*)input);
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0)
+        {
+            return input + __builtin_ctz((unsigned int)mask);
+        }
+        input += 16;
+    }
+}
+
+__attribute__((target("avx2"))) CJSON_NO_ASAN
+static const unsigned char *skip_plain_avx2(const unsigned char *input)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(31);
+
+    while (((size_t)input & 31) != 0)
+    {
+        if ((*input < 32) || (*input == '\"') || (*input == '\\'))
+        {
+            return input;
+        }
+        input++;
+    }
+    for (;;)
+    {
+        __m256i chunk = _mm256_load_si256((const __m256i*)(const void*)input);
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                                       _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hits);
+        if (mask != 0)
+        {
+            return input + __builtin_ctz(mask);
+        }
+        input += 32;
+    }
+}
+
+static const unsigned char *skip_unescaped_sse2(const unsigned char *input, const unsigned char * const end)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    while ((end - input) >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)input);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return input + __builtin_ctz((unsigned int)mask);
+        }
+        input += 16;
+    }
+    return skip_unescaped_scalar(input, end);
+}
+
+__attribute__((target("avx2")))
+static const unsigned char *skip_unescaped_avx2(const unsigned char *input, const unsigned char * const end)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    while ((end - input) >= 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(const void*)input);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return input + __builtin_ctz(mask);
+        }
+        input += 32;
+    }
+    return skip_unescaped_sse2(input, end);
+}
+#endif
+
+#if defined(CJSON_SIMD_NEON)
+CJSON_NO_ASAN
+static const unsigned char *skip_plain_neon(const unsigned char *input)
+{
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t control = vdupq_n_u8(32);
+
+    while (((size_t)input & 15) != 0)
+    {
+        if ((*input < 32) || (*input == '\"') || (*input == '\\'))
+        {
+            return input;
+        }
+        input++;
+    }
+    for (;;)
+    {
+        uint8x16_t chunk = vld1q_u8(input);
+        uint8x16_t hits = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)), vcltq_u8(chunk, control));
+        if (vmaxvq_u8(hits) != 0)
+        {
+            return skip_plain_scalar(input);
+        }
+        input += 16;
+    }
+}
+
+static const unsigned char *skip_unescaped_neon(const unsigned char *input, const unsigned char * const end)
+{
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+
+    while ((end - input) >= 16)
+    {
+        uint8x16_t chunk = vld1q_u8(input);
+        if (vmaxvq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash))) != 0)
+        {
+            break;
+        }
+        input += 16;
+    }
+    return skip_unescaped_scalar(input, end);
+}
+#endif
+
+static const unsigned char *skip_plain(const unsigned char *input)
+{
+#if defined(CJSON_SIMD_X86)
+    return cpu_has_avx2() ? skip_plain_avx2(input) : skip_plain_sse2(input);
+#elif defined(CJSON_SIMD_NEON)
+    return skip_plain_neon(input);
+#else
+    return skip_plain_scalar(input);
+#endif
+}
+
+static const unsigned char *skip_unescaped(const unsigned char *input, const unsigned char * const end)
+{
+#if defined(CJSON_SIMD_X86)
+    return cpu_has_avx2() ? skip_unescaped_avx2(input, end) : skip_unescaped_sse2(input, end);
+#elif defined(CJSON_SIMD_NEON)
+    return skip_unescaped_neon(input, end);
+#else
+    return skip_unescaped_scalar(input, end);
+#endif
+}
+
 /* Parse the input text into an unescaped cinput, and populate item. */
 static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -833,20 +1050,22 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
         size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        const unsigned char *buffer_end = input_buffer->content + input_buffer->length;
+        for (;;)
         {
+            input_end = skip_unescaped(input_end, buffer_end);
+            if ((input_end >= buffer_end) || (*input_end == '\"'))
+            {
+                break;
+            }
             /* is escape sequence */
-            if (input_end[0] == '\\')
+            if ((input_end + 1) >= buffer_end)
             {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
             }
-            input_end++;
+            skipped_bytes++;
+            input_end += 2;
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -868,7 +1087,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         if (*input_pointer != '\\')
         {
-            *output_pointer++ = *input_pointer++;
+            /* copy everything up to the next escape sequence at once */
+            const unsigned char *run_end = skip_unescaped(input_pointer + 1, input_end);
+            memcpy(output_pointer, input_pointer, (size_t)(run_end - input_pointer));
+            output_pointer += run_end - input_pointer;
+            input_pointer = run_end;
         }
         /* escape sequence */
         else
@@ -974,7 +1197,7 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     }
 
     /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++)
+    for (input_pointer = skip_plain(input); *input_pointer; input_pointer = skip_plain(input_pointer + 1))
     {
         switch (*input_pointer)
         {
@@ -1021,10 +1244,13 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     /* copy the string */
     for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
     {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        const unsigned char *plain_end = skip_plain(input_pointer);
+        if (plain_end != input_pointer)
         {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
+            /* run of normal characters, copy */
+            memcpy(output_pointer, input_pointer, (size_t)(plain_end - input_pointer));
+            output_pointer += plain_end - input_pointer - 1;
+            input_pointer = plain_end - 1;
         }
         else
         {
@@ -1359,6 +1585,31 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, cons
     return print_value(item, &p);
 }
 
+CJSON_PUBLIC(int) cJSON_PrintPreallocatedLength(cJSON *item, char *buffer, const int length, const cJSON_bool format)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+
+    if ((length < 0) || (buffer == NULL))
+    {
+        return -1;
+    }
+
+    p.buffer = (unsigned char*)buffer;
+    p.length = (size_t)length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+
+    if (!print_value(item, &p))
+    {
+        return -1;
+    }
+    update_offset(&p);
+
+    return (int)p.offset;
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {
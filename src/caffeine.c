@@ -87,6 +87,9 @@ int main(int argc, char **argv) {
 
     if (g_cfg.min_workers > g_cfg.max_workers) g_cfg.min_workers = g_cfg.max_workers;
 
+    // before the workers exist, they rely on map->watched from the start
+    int ifd = registry_watch(map);
+
     for (int i = 0; i < g_cfg.min_workers; i++) spawn_worker(map);
     
     fprintf(stdout, "%scaffeine: server running with %d workers on port %d%s\n\n", COLOR_GREEN, g_cfg.min_workers, g_cfg.port, COLOR_RESET);
@@ -111,23 +114,25 @@ int main(int argc, char **argv) {
     }
 
     struct itimerspec its = {
-        .it_interval = { .tv_sec = 5, .tv_nsec = 0 },
-        .it_value    = { .tv_sec = 5, .tv_nsec = 0 }
+        .it_interval = { .tv_sec = 0, .tv_nsec = MONITOR_TICK_MS * 1000000L },
+        .it_value    = { .tv_sec = 0, .tv_nsec = MONITOR_TICK_MS * 1000000L }
     };
 
     timerfd_settime(tfd, 0, &its, NULL);
 
-    struct pollfd fds[2];
+    struct pollfd fds[3];
     fds[0].fd = sigfd;
     fds[0].events = POLLIN;
     fds[1].fd = tfd;
     fds[1].events = POLLIN;
+    fds[2].fd = ifd; // ignored by poll() when -1
+    fds[2].events = POLLIN;
 
     if (monitor_init() < 0)
         free_and_exit(EXIT_FAILURE);
 
     while (!g_shutdown_requested) {
-        int ret = poll(fds, 2, -1);
+        int ret = poll(fds, 3, -1);
         if (ret < 0) {
             if (errno == EINTR) continue;
             perror("poll");
@@ -139,6 +144,9 @@ int main(int argc, char **argv) {
 
         if (fds[1].revents & POLLIN)
             monitor_and_scale(tfd, map);
+
+        if (fds[2].revents & POLLIN)
+            registry_handle_events(ifd, map);
     }
     
     sigset_t empty;
@@ -146,8 +154,8 @@ int main(int argc, char **argv) {
     sigprocmask(SIG_SETMASK, &empty, NULL);
 
     LOG_INFO("Server shutting down...");
-    for (int i = 0; i < g_cfg.current_workers; i++) {
-        if (map->workers[i].used)
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        if (map->workers[i].used && map->workers[i].pid > 0)
             kill(map->workers[i].pid, SIGTERM);
     }
     
@@ -155,6 +163,7 @@ int main(int argc, char **argv) {
         reap_workers(map);
 
     monitor_cleanup();
+    if (ifd >= 0) close(ifd);
     munmap(map, sizeof(shm_layout_t));
     free_and_exit(EXIT_SUCCESS);
     return 0;
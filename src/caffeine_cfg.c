@@ -29,6 +29,9 @@ void print_usage(const char *progname) {
     fprintf(stderr, "  -p, --port <port>      Set the listening port (default: %d).\n", DEFAULT_PORT);
     fprintf(stderr, "  -w, --workers <num>    Set the number of worker processes (default: %d).\n", DEFAULT_WORKERS);
     fprintf(stderr, "  --path <path>          Set the base path for executable handlers (default: %s).\n", EXEC_PATH);
+    fprintf(stderr, "  --preload              Load every handler in the supervisor so workers inherit them ready to run.\n");
+    fprintf(stderr, "  --hugepages            Back handler code and worker buffers with transparent huge pages.\n");
+    fprintf(stderr, "  --warmup <names>       Comma separated handlers (or '*') a new worker loads before accepting.\n");
     fprintf(stderr, "\n--- Content Deployment ---\n");
     fprintf(stderr, "  -d, --deploy <path>    Upload a file or directory to the server's execution path.\n");
     fprintf(stderr, "                         If <path> is a directory, its contents are copied recursively\n");
@@ -160,6 +163,16 @@ static void parse_config_line(char *line, int line_number) {
         if (g_cfg.exec_path) free(g_cfg.exec_path);
         g_cfg.exec_path = strdup(value);
         fprintf(stdout, "caffeine: config read: exec_path = %s\n", g_cfg.exec_path);
+    } else if (strcmp(key, "warmup") == 0) {
+        if (g_cfg.warmup) free(g_cfg.warmup);
+        g_cfg.warmup = strdup(value);
+        fprintf(stdout, "caffeine: config read: warmup = %s\n", g_cfg.warmup);
+    } else if (strcmp(key, "hugepages") == 0) {
+        g_cfg.hugepages = atoi(value) != 0;
+        fprintf(stdout, "caffeine: config read: hugepages = %d\n", g_cfg.hugepages);
+    } else if (strcmp(key, "preload") == 0) {
+        g_cfg.preload = atoi(value) != 0;
+        fprintf(stdout, "caffeine: config read: preload = %d\n", g_cfg.preload);
     } 
 }
 
@@ -229,6 +242,14 @@ int parse_arguments(int argc, char **argv) {
                 fprintf(stderr, "%scaffeine: error: configuration file%s\n", COLOR_BRIGHT_RED, COLOR_RESET);
                 return -1;
             }
+        } else if (strcmp(arg, "--warmup") == 0) {
+            CHECK_ARG(arg);
+            free(g_cfg.warmup);
+            g_cfg.warmup = strdup(argv[i]);
+        } else if (strcmp(arg, "--hugepages") == 0) {
+            g_cfg.hugepages = 1;
+        } else if (strcmp(arg, "--preload") == 0) {
+            g_cfg.preload = 1;
         } else if (strcmp(arg, "-D") == 0 || strcmp(arg, "--daemon") == 0) {
             g_cfg.daemonize = 1;
         } else if (strcmp(arg, "-d") == 0 || strcmp(arg, "--deploy") == 0) {
@@ -270,7 +291,7 @@ int parse_arguments(int argc, char **argv) {
     if (g_cfg.delete_logs) { printf("caffeine: log %s removed\n", get_log_path()); remove(get_log_path()); free_and_exit(EXIT_SUCCESS); }
     if (g_cfg.stop_instance) { stop_server(); free_and_exit(EXIT_SUCCESS); }
     if (g_cfg.list_instances) { list_running_instances(); free_and_exit(EXIT_SUCCESS);}
-    g_cfg.current_workers = g_cfg.min_workers;
+    g_cfg.current_workers = 0; // counted by spawn_worker()
     set_log_level(g_cfg.log_level);
     return 0;
 }
@@ -10,6 +10,7 @@
 void free_and_exit(int status) {
     if (g_cfg.instance_name) free(g_cfg.instance_name);
     if (g_cfg.exec_path) free(g_cfg.exec_path);
+    if (g_cfg.warmup) free(g_cfg.warmup);
     if (g_cfg.log_level) free(g_cfg.log_level);
     if (g_cfg.socket_path) free(g_cfg.socket_path);
     if (g_cfg.log_path) free(g_cfg.log_path);
@@ -48,6 +49,30 @@ ssize_t write_fully(int fd, const char *buf, size_t count) {
     return total_written;
 }
 
+ssize_t writev_fully(int fd, struct iovec *iov, int iovcnt) {
+    size_t total_written = 0;
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) return -1;
+
+        total_written += n;
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return total_written;
+}
+
 /* TO FIX */
 char *find_headers_end(const char *__haystack, const char *__needle, size_t size)
 {
@@ -174,8 +199,29 @@ unsigned long hash_path(const char *str) {
     return hash;
 }
 
+// FNV-1a with the murmur3 finalizer, so that the low bits used as a table index are well mixed
+uint64_t hash_name(const char *str, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
 uint64_t now_ms(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include <delta.h>
+#include <log.h>
+#include <stdlib.h>
+#include <string.h>
+
+delta_history_t* delta_history_new(int max_versions) {
+    delta_history_t *h = calloc(1, sizeof(delta_history_t));
+    if (!h) {
+        LOG_ERROR("delta: failed to allocate version history");
+        return NULL;
+    }
+    h->max_versions = max_versions > DELTA_MAX_VERSIONS ? DELTA_MAX_VERSIONS : max_versions;
+    return h;
+}
+
+static void key_clear(delta_key_t *k) {
+    for (size_t i = 0; i < DELTA_MAX_VERSIONS; i++) free(k->versions[i].json);
+    memset(k, 0, sizeof(delta_key_t));
+}
+
+void delta_history_free(delta_history_t *h) {
+    if (!h) return;
+    for (size_t i = 0; i < h->nkeys; i++) key_clear(&h->keys[i]);
+    free(h);
+}
+
+// FNV-1a, used both for the path keys and the ETags
+uint64_t delta_hash(const char *data, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static delta_key_t* key_lookup(delta_history_t *h, uint64_t key) {
+    for (size_t i = 0; i < h->nkeys; i++) {
+        if (h->keys[i].key == key) {
+            h->keys[i].last_used = ++h->tick;
+            return &h->keys[i];
+        }
+    }
+    return NULL;
+}
+
+const delta_version_t* delta_find(delta_history_t *h, uint64_t key, uint64_t etag) {
+    delta_key_t *k = key_lookup(h, key);
+    if (!k) return NULL;
+
+    for (size_t i = 0; i < k->count; i++) {
+        if (k->versions[i].etag == etag) return &k->versions[i];
+    }
+    return NULL;
+}
+
+int delta_record(delta_history_t *h, uint64_t key, uint64_t etag, const char *body, size_t len) {
+    delta_key_t *k = key_lookup(h, key);
+    if (!k) {
+        if (h->nkeys < DELTA_MAX_KEYS) {
+            k = &h->keys[h->nkeys++];
+        } else {
+            k = &h->keys[0];
+            for (size_t i = 1; i < h->nkeys; i++) {
+                if (h->keys[i].last_used < k->last_used) k = &h->keys[i];
+            }
+            key_clear(k);
+        }
+        k->key = key;
+        k->last_used = ++h->tick;
+    }
+
+    // the newest version is the one most clients hold
+    if (k->count && k->versions[(k->head + k->count - 1) % h->max_versions].etag == etag) return 0;
+
+    char *copy = malloc(len);
+    if (!copy) {
+        LOG_ERROR("delta: failed to keep a %zu byte response", len);
+        return -1;
+    }
+    memcpy(copy, body, len);
+
+    delta_version_t *v;
+    if (k->count < (size_t)h->max_versions) {
+        v = &k->versions[(k->head + k->count++) % h->max_versions];
+    } else {
+        v = &k->versions[k->head];
+        k->head = (k->head + 1) % h->max_versions;
+        free(v->json);
+    }
+    v->etag = etag;
+    v->json = copy;
+    v->len = len;
+    return 0;
+}
@@ -12,9 +12,15 @@
 
 #define COPY_BUFFER_SIZE 4096
 
+/*
+ * The file is written next to its destination under a hidden temporary
+ * name and renamed over it. Workers may have the old .so mapped, truncating
+ * it in place would pull the pages out from under them.
+ */
 int deploy_single_file(const char *src_path, const char *dst_path) {
     int src_fd = -1;
     int dst_fd = -1;
+    char tmp_path[MAX_PATH];
     char buffer[COPY_BUFFER_SIZE];
     ssize_t bytes_read, bytes_written;
     int result = -1;
@@ -26,7 +32,15 @@ int deploy_single_file(const char *src_path, const char *dst_path) {
         return -1;
     }
 
-    dst_fd = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    const char *base = strrchr(dst_path, '/');
+    int dir_len = base ? (int)(base - dst_path + 1) : 0;
+    base = base ? base + 1 : dst_path;
+    if (snprintf(tmp_path, MAX_PATH, "%.*s.%s.XXXXXX", dir_len, dst_path, base) >= MAX_PATH) {
+        fprintf(stderr, "%scaffeine: error: destination path too long '%s'%s\n", COLOR_BRIGHT_RED, dst_path, COLOR_RESET);
+        goto cleanup;
+    }
+
+    dst_fd = mkstemp(tmp_path);
     if (dst_fd == -1) {
         fprintf(stderr, "caffeine: error: failed to create destination file '%s': %s\n", dst_path, strerror(errno));
         goto cleanup;
@@ -49,14 +63,19 @@ int deploy_single_file(const char *src_path, const char *dst_path) {
         fprintf(stderr, "%scaffeine: error: read error from source file '%s': %s%s", COLOR_BRIGHT_RED, src_path, strerror(errno), COLOR_RESET);
         goto cleanup;
     }
-    if (chmod(dst_path, 0755) == -1) {
+    if (fchmod(dst_fd, 0755) == -1) {
         fprintf(stdout, "%scaffeine: warning: failed to set executable permissions on '%s': %s%s\n", COLOR_BRIGHT_YELLOW, dst_path, strerror(errno), COLOR_RESET);
     }
+    if (rename(tmp_path, dst_path) == -1) {
+        fprintf(stderr, "%scaffeine: error: failed to replace '%s': %s%s\n", COLOR_BRIGHT_RED, dst_path, strerror(errno), COLOR_RESET);
+        goto cleanup;
+    }
     result = 0;
 
 cleanup:
     if (src_fd != -1) close(src_fd);
     if (dst_fd != -1) close(dst_fd);
+    if (dst_fd != -1 && result != 0) unlink(tmp_path);
 
     return result;
 }
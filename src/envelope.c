@@ -0,0 +1,265 @@
+#include <envelope.h>
+#include <json_tape.h>
+#include <cJSON.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char* skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+// p points at the opening quote, returns the closing one
+static const char* scan_string(const char *p, const char *end, int *escaped) {
+    for (p++; p < end; p++) {
+        if (*p == '"') return p;
+        if (*p == '\\') {
+            *escaped = 1;
+            if (++p == end) return NULL;
+        }
+    }
+    return NULL;
+}
+
+// only checks that brackets balance and strings terminate, the bytes are forwarded as they are
+static const char* scan_container(const char *p, const char *end) {
+    char stack[CJSON_NESTING_LIMIT];
+    size_t depth = 0;
+    int escaped;
+
+    for (; p < end; p++) {
+        switch (*p) {
+            case '{':
+            case '[':
+                if (depth == sizeof(stack)) return NULL;
+                stack[depth++] = (*p == '{') ? '}' : ']';
+                break;
+            case '}':
+            case ']':
+                if (depth == 0 || stack[--depth] != *p) return NULL;
+                if (depth == 0) return p + 1;
+                break;
+            case '"':
+                p = scan_string(p, end, &escaped);
+                if (!p) return NULL;
+                break;
+        }
+    }
+    return NULL;
+}
+
+static const char* scan_scalar(const char *p, const char *end) {
+    const char *start = p;
+    while (p < end && (isalnum((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.')) p++;
+    size_t len = p - start;
+
+    if (len == 0) return NULL;
+    if (*start == '-' || isdigit((unsigned char)*start)) return p;
+    if ((len == 4 && !memcmp(start, "true", 4)) || (len == 4 && !memcmp(start, "null", 4)) ||
+        (len == 5 && !memcmp(start, "false", 5))) return p;
+    return NULL;
+}
+
+static const char* scan_value(const char *p, const char *end, int *escaped) {
+    if (*p == '"') {
+        p = scan_string(p, end, escaped);
+        return p ? p + 1 : NULL;
+    }
+    if (*p == '{' || *p == '[') return scan_container(p, end);
+    return scan_scalar(p, end);
+}
+
+// same clamping as cJSON's valueint
+static int parse_status(const char *p, const char *end) {
+    char num[64];
+    size_t len = end - p;
+    if (len >= sizeof(num)) len = sizeof(num) - 1;
+    memcpy(num, p, len);
+    num[len] = 0;
+
+    double d = strtod(num, NULL);
+    if (d >= INT_MAX) return INT_MAX;
+    if (d <= (double)INT_MIN) return INT_MIN;
+    return (int)d;
+}
+
+/*
+ * Member names are matched case-insensitively and the first occurrence
+ * wins, as with cJSON_GetObjectItem(). The scan stops as soon as both
+ * members are known, so whatever follows them is not validated.
+ */
+int envelope_scan(const char *json, size_t len, envelope_t *env) {
+    const char *p = json, *end = json + len;
+    int have_status = 0, have_body = 0, slow = 0;
+
+    env->status = 200;
+    env->body = "";
+    env->body_len = 0;
+    env->body_is_string = 0;
+
+    p = skip_ws(p, end);
+    if (p == end || *p != '{') return -1;
+    p = skip_ws(p + 1, end);
+    if (p < end && *p == '}') return 0;
+
+    for (;;) {
+        int key_escaped = 0, val_escaped = 0;
+
+        if (p == end || *p != '"') return -1;
+        const char *key = p + 1;
+        const char *key_end = scan_string(p, end, &key_escaped);
+        if (!key_end) return -1;
+        size_t key_len = key_end - key;
+
+        p = skip_ws(key_end + 1, end);
+        if (p == end || *p != ':') return -1;
+        p = skip_ws(p + 1, end);
+        if (p == end) return -1;
+
+        const char *val = p;
+        const char *val_end = scan_value(p, end, &val_escaped);
+        if (!val_end) return -1;
+
+        if (key_escaped) {
+            slow = 1;
+        } else if (!have_status && key_len == 6 && !strncasecmp(key, "status", 6)) {
+            have_status = 1;
+            if (*val == '-' || isdigit((unsigned char)*val)) env->status = parse_status(val, val_end);
+        } else if (!have_body && key_len == 4 && !strncasecmp(key, "body", 4)) {
+            have_body = 1;
+            if (*val == '"') {
+                if (val_escaped) slow = 1;
+                env->body_is_string = 1;
+                env->body = val + 1;
+                env->body_len = (val_end - 1) - (val + 1);
+            } else {
+                env->body = val;
+                env->body_len = val_end - val;
+            }
+        }
+        if (have_status && have_body && !slow) return 0;
+
+        p = skip_ws(val_end, end);
+        if (p < end && *p == ',') {
+            p = skip_ws(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == '}') break;
+        return -1;
+    }
+    return slow ? ENVELOPE_SLOW_PATH : 0;
+}
+
+// member names are short, longer (or escaped beyond recognition) ones never match
+static int key_is(const caffeine_json_t *doc, uint32_t k, const char *name) {
+    char key[16];
+    size_t len;
+    caffeine_json_str(doc, k, &len);
+    if (len >= sizeof(key)) return 0;
+
+    len = caffeine_json_unescape(doc, k, key);
+    return len == strlen(name) && !strncasecmp(key, name, len);
+}
+
+int envelope_decode(arena_t *arena, const char *json, size_t len, envelope_t *env) {
+    caffeine_json_t doc;
+    uint32_t status = CAFFEINE_JSON_NONE, body = CAFFEINE_JSON_NONE;
+
+    env->status = 200;
+    env->body = "";
+    env->body_len = 0;
+    env->body_is_string = 0;
+
+    if (json_tape_build(arena, json, len, &doc) < 0 || caffeine_json_type(&doc, 0) != CAFFEINE_JSON_OBJECT) return -1;
+
+    for (uint32_t k = caffeine_json_first(&doc, 0); k != CAFFEINE_JSON_NONE; k = caffeine_json_next(&doc, 0, k + 1)) {
+        if (status == CAFFEINE_JSON_NONE && key_is(&doc, k, "status")) status = k + 1;
+        else if (body == CAFFEINE_JSON_NONE && key_is(&doc, k, "body")) body = k + 1;
+    }
+
+    if (status != CAFFEINE_JSON_NONE && caffeine_json_type(&doc, status) == CAFFEINE_JSON_NUMBER) {
+        size_t num_len;
+        const char *num = caffeine_json_raw(&doc, status, &num_len);
+        env->status = parse_status(num, num + num_len);
+    }
+    if (body == CAFFEINE_JSON_NONE) return 0;
+
+    if (caffeine_json_type(&doc, body) == CAFFEINE_JSON_STRING) {
+        size_t escaped_len;
+        caffeine_json_str(&doc, body, &escaped_len);
+        char *decoded = arena_alloc(arena, escaped_len + 1);
+        if (!decoded) return -1;
+        env->body_len = caffeine_json_unescape(&doc, body, decoded);
+        env->body = decoded;
+        env->body_is_string = 1;
+    } else {
+        env->body = caffeine_json_raw(&doc, body, &env->body_len);
+    }
+    return 0;
+}
+
+#define PUT_LITERAL(dst, lit) (memcpy((dst), (lit), sizeof(lit) - 1), (dst) + sizeof(lit) - 1)
+
+// escapes exactly the bytes cJSON escapes, runs of plain bytes are copied at once
+static char* put_escaped(char *dst, const char *src, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    const char *end = src + len;
+
+    while (src < end) {
+        const char *run = src;
+        while (src < end && (unsigned char)*src >= 0x20 && *src != '"' && *src != '\\') src++;
+        memcpy(dst, run, src - run);
+        dst += src - run;
+        if (src == end) break;
+
+        unsigned char c = (unsigned char)*src++;
+        *dst++ = '\\';
+        switch (c) {
+            case '"':  *dst++ = '"'; break;
+            case '\\': *dst++ = '\\'; break;
+            case '\b': *dst++ = 'b'; break;
+            case '\f': *dst++ = 'f'; break;
+            case '\n': *dst++ = 'n'; break;
+            case '\r': *dst++ = 'r'; break;
+            case '\t': *dst++ = 't'; break;
+            default:
+                *dst++ = 'u';
+                *dst++ = '0';
+                *dst++ = '0';
+                *dst++ = hex[c >> 4];
+                *dst++ = hex[c & 0xf];
+                break;
+        }
+    }
+    return dst;
+}
+
+size_t envelope_request_max(const headers_t *hdrs) {
+    // worst case every byte becomes \u00XX
+    return sizeof("{\"method\":\"\",\"path\":\"\",\"handler\":\"\",\"headers\":\"\"}")
+        + sizeof(hdrs->method)
+        + 6 * (strnlen(hdrs->path, sizeof(hdrs->path)) + strnlen(hdrs->handler_name, sizeof(hdrs->handler_name)) + hdrs->bytes_read);
+}
+
+size_t envelope_write_request(char *dst, const headers_t *hdrs) {
+    char *p = dst;
+
+    p = PUT_LITERAL(p, "{\"method\":\"");
+    // read_headers() only accepts a fixed set of upper-case methods
+    size_t len = strnlen(hdrs->method, sizeof(hdrs->method));
+    memcpy(p, hdrs->method, len);
+    p += len;
+    p = PUT_LITERAL(p, "\",\"path\":\"/");
+    p = put_escaped(p, hdrs->path, strnlen(hdrs->path, sizeof(hdrs->path)));
+    p = PUT_LITERAL(p, "\",\"handler\":\"");
+    p = put_escaped(p, hdrs->handler_name, strnlen(hdrs->handler_name, sizeof(hdrs->handler_name)));
+    p = PUT_LITERAL(p, "\",\"headers\":\"");
+    p = put_escaped(p, hdrs->headers, strnlen(hdrs->headers, hdrs->bytes_read));
+    p = PUT_LITERAL(p, "\"}");
+    *p = 0;
+
+    return p - dst;
+}
@@ -0,0 +1,83 @@
+#include <guard_buf.h>
+#include <log.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ALIGN_UP(n, a) (((n) + ((a) - 1)) & ~((size_t)(a) - 1))
+
+int guard_buf_init(guard_buf_t *b, size_t cap, size_t max_cap) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    memset(b, 0, sizeof(guard_buf_t));
+    cap = ALIGN_UP(cap, page);
+    max_cap = ALIGN_UP(max_cap < cap ? cap : max_cap, page);
+
+    // leading guard page + max_cap + trailing guard page, all inaccessible
+    b->reserved = max_cap + 2 * page;
+    char *region = mmap(NULL, b->reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        LOG_ERROR("guard_buf: reserving %zu bytes failed: %s", b->reserved, strerror(errno));
+        return -1;
+    }
+
+    b->base = region + page;
+    if (mprotect(b->base, cap, PROT_READ | PROT_WRITE) < 0) {
+        LOG_ERROR("guard_buf: mprotect failed: %s", strerror(errno));
+        munmap(region, b->reserved);
+        b->base = NULL;
+        return -1;
+    }
+    b->cap = cap;
+    b->min_cap = cap;
+    b->max_cap = max_cap;
+    return 0;
+}
+
+int guard_buf_grow(guard_buf_t *b, size_t need) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (need <= b->cap) return 0;
+    if (need > b->max_cap) return -1;
+
+    size_t cap = b->cap;
+    while (cap < need) cap *= 2;
+    if (cap > b->max_cap) cap = b->max_cap;
+    cap = ALIGN_UP(cap, page);
+
+    if (mprotect(b->base + b->cap, cap - b->cap, PROT_READ | PROT_WRITE) < 0) {
+        LOG_ERROR("guard_buf: growing to %zu bytes failed: %s", cap, strerror(errno));
+        return -1;
+    }
+    b->cap = cap;
+    return 0;
+}
+
+/*
+ * Returns the pages above the initial size to the OS and puts the guard
+ * back right after it.
+ */
+void guard_buf_shrink(guard_buf_t *b) {
+    if (b->cap <= b->min_cap) return;
+
+    madvise(b->base + b->min_cap, b->cap - b->min_cap, MADV_DONTNEED);
+    mprotect(b->base + b->min_cap, b->cap - b->min_cap, PROT_NONE);
+    b->cap = b->min_cap;
+}
+
+// faults the usable pages in now instead of on the first requests
+void guard_buf_prefault(guard_buf_t *b) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(b->base, b->cap, MADV_POPULATE_WRITE) == 0) return;
+#endif
+    for (size_t off = 0; off < b->cap; off += page) ((volatile char *)b->base)[off] = 0;
+}
+
+void guard_buf_destroy(guard_buf_t *b) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (b->base) munmap(b->base - page, b->reserved);
+    memset(b, 0, sizeof(guard_buf_t));
+}
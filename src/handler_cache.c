@@ -0,0 +1,81 @@
+#include <handler_cache.h>
+#include <log.h>
+
+static int cache_grow(handler_cache_t *cache) {
+    size_t capacity = cache->capacity ? cache->capacity * 2 : HANDLER_CACHE_MIN_CAPACITY;
+    handler_entry_t **slots = calloc(capacity, sizeof(handler_entry_t *));
+    if (!slots) {
+        LOG_ERROR("handler cache: failed to grow to %zu slots", capacity);
+        return -1;
+    }
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        handler_entry_t *e = cache->slots[i];
+        if (!e) continue;
+        size_t j = e->hash & (capacity - 1);
+        while (slots[j]) j = (j + 1) & (capacity - 1);
+        slots[j] = e;
+    }
+    free(cache->slots);
+    cache->slots = slots;
+    cache->capacity = capacity;
+    return 0;
+}
+
+handler_entry_t* handler_cache_find(handler_cache_t *cache, const char *name, uint64_t hash) {
+    if (!cache->capacity) return NULL;
+
+    size_t mask = cache->capacity - 1;
+    for (size_t i = hash & mask; cache->slots[i]; i = (i + 1) & mask) {
+        handler_entry_t *e = cache->slots[i];
+        if (e->hash == hash && !strcmp(e->name, name)) return e;
+    }
+    return NULL;
+}
+
+handler_entry_t* handler_cache_insert(handler_cache_t *cache, const char *name, uint64_t hash) {
+    // keep the load factor under 3/4 so probe chains stay short
+    if ((cache->size + 1) * 4 > cache->capacity * 3 && cache_grow(cache) < 0) return NULL;
+
+    handler_entry_t *e = calloc(1, sizeof(handler_entry_t));
+    if (!e) {
+        LOG_ERROR("handler cache: failed to allocate an entry for %s", name);
+        return NULL;
+    }
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    e->hash = hash;
+    e->so_fd = -1;
+
+    size_t mask = cache->capacity - 1;
+    size_t i = hash & mask;
+    while (cache->slots[i]) i = (i + 1) & mask;
+    cache->slots[i] = e;
+    cache->size++;
+    return e;
+}
+
+/*
+ * Puts a blank entry with the same name in entry's slot and moves entry to
+ * cache->retired. The caller unloads and frees it once unreferenced.
+ */
+handler_entry_t* handler_cache_retire(handler_cache_t *cache, handler_entry_t *entry) {
+    handler_entry_t *e = calloc(1, sizeof(handler_entry_t));
+    if (!e) {
+        LOG_ERROR("handler cache: failed to allocate an entry for %s", entry->name);
+        return NULL;
+    }
+    memcpy(e->name, entry->name, sizeof(e->name));
+    e->hash = entry->hash;
+    e->shm_idx = entry->shm_idx;
+    e->so_fd = -1;
+
+    size_t mask = cache->capacity - 1;
+    size_t i = entry->hash & mask;
+    while (cache->slots[i] != entry) i = (i + 1) & mask;
+    cache->slots[i] = e;
+
+    entry->retired = 1;
+    entry->next_retired = cache->retired;
+    cache->retired = entry;
+    return e;
+}
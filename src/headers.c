@@ -7,6 +7,8 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <strings.h>
+#include <sys/socket.h>
 
 static void strupperncpy(char *__restrict __dest, const char *__restrict __src, size_t max_size) {
     int i = 0;
@@ -17,12 +19,17 @@ static void strupperncpy(char *__restrict __dest, const char *__restrict __src,
     __dest[i] = 0;
 }
 
+/*
+ * Reads what the client has sent so far without waiting for more. Returns
+ * 1 once the headers are complete and parsed, 0 when they are not all there
+ * yet (call again when client_fd is readable, hdrs keeps what was read) and
+ * -1 when the request is unusable or the client went away.
+ */
 int read_headers(int client_fd, headers_t *hdrs) {
     ssize_t bytes_read = 0;
 
-    int i = 0;
     while (hdrs->bytes_read < sizeof(hdrs->headers) - 1) {
-        bytes_read = read(client_fd, hdrs->headers + hdrs->bytes_read, sizeof(hdrs->headers) - 1 - hdrs->bytes_read);
+        bytes_read = recv(client_fd, hdrs->headers + hdrs->bytes_read, sizeof(hdrs->headers) - 1 - hdrs->bytes_read, MSG_DONTWAIT);
 
         if (bytes_read > 0) {
             hdrs->bytes_read += bytes_read;
@@ -79,25 +86,36 @@ int read_headers(int client_fd, headers_t *hdrs) {
         } else if (bytes_read == 0) {
             return -1;
         } else if (bytes_read == -1) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                struct pollfd pfd = {.fd = client_fd, .events = POLLIN};
-
-                int poll_result = poll(&pfd, 1, 5000);
-                if (poll_result < 0) {
-                    if (errno == EINTR) continue;
-                    LOG_ERROR("poll failed: %s", strerror(errno));
-                    return -1;
-                } else if (poll_result == 0) {
-                    LOG_WARN("Client timeout while reading headers on FD %d.", client_fd);
-                    return -1;
-                }
-            } else {
-                LOG_ERROR("read failed: %s", strerror(errno));                
-                return -1;
-            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            if (errno == EINTR) continue;
+            LOG_ERROR("read failed: %s", strerror(errno));
+            return -1;
         }
     }
     
     if (!hdrs->headers_end) return -1;
     return 1;
-}
\ No newline at end of file
+}
+
+// value of the first header line called name, blanks trimmed, or NULL
+const char* find_header(const char *headers, const char *name, size_t *len) {
+    size_t name_len = strlen(name);
+    const char *line = strstr(headers, "\r\n");
+
+    while (line && line[2] && line[2] != '\r') {
+        line += 2;
+        const char *eol = strstr(line, "\r\n");
+        if (!eol) return NULL;
+
+        if ((size_t)(eol - line) > name_len && line[name_len] == ':' && !strncasecmp(line, name, name_len)) {
+            const char *v = line + name_len + 1;
+            while (v < eol && (*v == ' ' || *v == '\t')) v++;
+            const char *end = eol;
+            while (end > v && (end[-1] == ' ' || end[-1] == '\t')) end--;
+            *len = end - v;
+            return v;
+        }
+        line = eol;
+    }
+    return NULL;
+}
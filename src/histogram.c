@@ -0,0 +1,65 @@
+#include <histogram.h>
+
+void hist_snapshot(const hist_t *h, hist_snapshot_t *out) {
+    out->count = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        out->buckets[b] = atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        out->count += out->buckets[b];
+    }
+}
+
+// what was recorded between two snapshots of the same histogram
+void hist_delta(const hist_snapshot_t *now, const hist_snapshot_t *before, hist_snapshot_t *out) {
+    out->count = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        out->buckets[b] = now->buckets[b] - before->buckets[b];
+        out->count += out->buckets[b];
+    }
+}
+
+void hist_merge(hist_snapshot_t *into, const hist_snapshot_t *from) {
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) into->buckets[b] += from->buckets[b];
+    into->count += from->count;
+}
+
+// highest value of bucket b, what a percentile falling into it reports
+static uint64_t bucket_max(uint32_t b) {
+    if (b < HIST_SUB) return b;
+    uint32_t exp = b / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t sub = b % HIST_SUB;
+    return ((HIST_SUB + sub + 1) << (exp - HIST_SUB_BITS)) - 1;
+}
+
+// p in [0, 100], 0 for an empty snapshot
+uint64_t hist_percentile(const hist_snapshot_t *s, double p) {
+    if (!s->count) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * s->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > s->count) rank = s->count;
+
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        seen += s->buckets[b];
+        if (seen >= rank) return bucket_max(b);
+    }
+    return bucket_max(HIST_BUCKETS - 1);
+}
+
+// highest value of coarse bucket b
+static uint64_t coarse_bucket_max(uint32_t b) {
+    if (b < 2) return b;
+    uint32_t exp = b / 2;
+    uint64_t sub = b & 1;
+    return ((2 + sub + 1) << (exp - 1)) - 1;
+}
+
+// each coarse bucket lands in the fine bucket holding its highest value, so percentiles report that
+void hist_coarse_merge(hist_snapshot_t *into, const hist_coarse_t *h) {
+    for (uint32_t b = 0; b < HIST_COARSE_BUCKETS; b++) {
+        uint64_t n = atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        if (!n) continue;
+        into->buckets[hist_bucket(coarse_bucket_max(b))] += n;
+        into->count += n;
+    }
+}
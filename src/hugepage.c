@@ -0,0 +1,97 @@
+#define _GNU_SOURCE // dlinfo
+#include <hugepage.h>
+#include <log.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <sys/mman.h>
+
+#define ALIGN_UP(n, a) (((n) + ((a) - 1)) & ~((uintptr_t)(a) - 1))
+#define ALIGN_DOWN(n, a) ((n) & ~((uintptr_t)(a) - 1))
+
+// only the huge page aligned part of a range can be backed by huge pages
+void hugepage_advise(void *addr, size_t len) {
+    uintptr_t start = ALIGN_UP((uintptr_t)addr, HUGE_PAGE_SIZE);
+    uintptr_t end = ALIGN_DOWN((uintptr_t)addr + len, HUGE_PAGE_SIZE);
+    if (end > start) madvise((void *)start, end - start, MADV_HUGEPAGE);
+}
+
+/*
+ * Anonymous mapping of len rounded up to whole huge pages, aligned so that
+ * all of it is eligible. Released with munmap() of the rounded length.
+ */
+void* hugepage_alloc(size_t len) {
+    len = ALIGN_UP(len, HUGE_PAGE_SIZE);
+    char *p = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+
+    char *aligned = (char *)ALIGN_UP((uintptr_t)p, HUGE_PAGE_SIZE);
+    if (aligned > p) munmap(p, aligned - p);
+    munmap(aligned + len, p + HUGE_PAGE_SIZE - aligned);
+    madvise(aligned, len, MADV_HUGEPAGE);
+    return aligned;
+}
+
+typedef struct {
+    ElfW(Addr)  base;
+    int         segments;
+}   text_ctx_t;
+
+static int advise_text(struct dl_phdr_info *info, size_t size, void *arg) {
+    text_ctx_t *ctx = arg;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    (void)size;
+
+    if (info->dlpi_addr != ctx->base) return 0;
+
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_LOAD || !(ph->p_flags & PF_X)) continue;
+
+        uintptr_t start = ALIGN_DOWN(info->dlpi_addr + ph->p_vaddr, page);
+        uintptr_t end = ALIGN_UP(info->dlpi_addr + ph->p_vaddr + ph->p_memsz, page);
+        madvise((void *)start, end - start, MADV_HUGEPAGE);
+#ifdef MADV_COLLAPSE
+        // synchronous, instead of waiting for khugepaged to get to it
+        uintptr_t hs = ALIGN_UP(start, HUGE_PAGE_SIZE), he = ALIGN_DOWN(end, HUGE_PAGE_SIZE);
+        if (he > hs) madvise((void *)hs, he - hs, MADV_COLLAPSE);
+#endif
+#ifdef MADV_POPULATE_READ
+        madvise((void *)start, end - start, MADV_POPULATE_READ);
+#endif
+        ctx->segments++;
+    }
+    return 1;
+}
+
+/*
+ * Asks for the executable segments of a loaded object to be backed by
+ * huge pages and faults them in. Returns the number of segments handled.
+ */
+int hugepage_text(void *dl_handle) {
+    struct link_map *lm;
+    if (dlinfo(dl_handle, RTLD_DI_LINKMAP, &lm) < 0) return 0;
+
+    text_ctx_t ctx = { .base = lm->l_addr, .segments = 0 };
+    dl_iterate_phdr(advise_text, &ctx);
+    return ctx.segments;
+}
+
+// huge page backed memory of this process, from smaps_rollup
+int hugepage_usage(size_t *anon_kb, size_t *file_kb) {
+    char line[256];
+    FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+    if (!fp) return -1;
+
+    *anon_kb = 0;
+    *file_kb = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strncmp(line, "AnonHugePages:", 14)) sscanf(line + 14, "%zu", anon_kb);
+        else if (!strncmp(line, "FilePmdMapped:", 14)) sscanf(line + 14, "%zu", file_kb);
+    }
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <json_tape.h>
+#include <log.h>
+#include <ctype.h>
+#include <string.h>
+
+typedef struct {
+    arena_t                 *arena;
+    const char              *src;
+    const char              *p;
+    const char              *end;
+    caffeine_json_node_t    *nodes;
+    uint32_t                count;
+    uint32_t                cap;
+    int                     depth;
+}   tape_builder_t;
+
+static const char* skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+static int push_node(tape_builder_t *b, uint32_t type) {
+    if (b->count == b->cap) {
+        // the old tape stays in the arena until the request ends
+        uint32_t cap = b->cap * 2;
+        caffeine_json_node_t *nodes = arena_alloc(b->arena, cap * sizeof(caffeine_json_node_t));
+        if (!nodes) return -1;
+        memcpy(nodes, b->nodes, b->count * sizeof(caffeine_json_node_t));
+        b->nodes = nodes;
+        b->cap = cap;
+    }
+    caffeine_json_node_t *n = &b->nodes[b->count];
+    n->offset = (uint32_t)(b->p - b->src);
+    n->flags = type;
+    return (int)b->count++;
+}
+
+static int scan_string(tape_builder_t *b, uint32_t idx) {
+    const char *p = b->p + 1;
+    while (p < b->end && *p != '"') {
+        if (*p == '\\') {
+            b->nodes[idx].flags |= CAFFEINE_JSON_ESCAPED;
+            if (++p == b->end) return -1;
+            if (*p == 'u') {
+                if (b->end - p < 5) return -1;
+                for (int k = 1; k <= 4; k++) if (!isxdigit((unsigned char)p[k])) return -1;
+                p += 4;
+            } else if (!*p || !strchr("\"\\/bfnrt", *p)) {
+                return -1;
+            }
+        } else if ((unsigned char)*p < 0x20) {
+            return -1; // control characters must be escaped
+        }
+        p++;
+    }
+    if (p == b->end) return -1;
+    b->p = p + 1;
+    return 0;
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static int scan_number(tape_builder_t *b) {
+    const char *p = b->p, *end = b->end;
+    if (p < end && *p == '-') p++;
+    if (p == end || !isdigit((unsigned char)*p)) return -1;
+    if (*p == '0') p++;
+    else while (p < end && isdigit((unsigned char)*p)) p++;
+    if (p < end && *p == '.') {
+        if (++p == end || !isdigit((unsigned char)*p)) return -1;
+        while (p < end && isdigit((unsigned char)*p)) p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p == end || !isdigit((unsigned char)*p)) return -1;
+        while (p < end && isdigit((unsigned char)*p)) p++;
+    }
+    b->p = p;
+    return 0;
+}
+
+static int scan_literal(tape_builder_t *b, const char *lit, size_t len) {
+    if ((size_t)(b->end - b->p) < len || memcmp(b->p, lit, len)) return -1;
+    b->p += len;
+    return 0;
+}
+
+static int parse_value(tape_builder_t *b);
+
+static int parse_container(tape_builder_t *b, char close) {
+    if (++b->depth > JSON_TAPE_MAX_DEPTH) return -1;
+
+    b->p = skip_ws(b->p + 1, b->end);
+    if (b->p < b->end && *b->p == close) {
+        b->p++;
+        b->depth--;
+        return 0;
+    }
+
+    for (;;) {
+        if (close == '}') {
+            if (b->p == b->end || *b->p != '"' || parse_value(b) < 0) return -1;
+            b->p = skip_ws(b->p, b->end);
+            if (b->p == b->end || *b->p != ':') return -1;
+            b->p++;
+        }
+        if (parse_value(b) < 0) return -1;
+
+        b->p = skip_ws(b->p, b->end);
+        if (b->p == b->end) return -1;
+        if (*b->p == close) break;
+        if (*b->p != ',') return -1;
+        b->p = skip_ws(b->p + 1, b->end);
+    }
+    b->p++;
+    b->depth--;
+    return 0;
+}
+
+static int parse_value(tape_builder_t *b) {
+    b->p = skip_ws(b->p, b->end);
+    if (b->p == b->end) return -1;
+
+    const char *start = b->p;
+    int idx, rc;
+    switch (*b->p) {
+        case '"':
+            if ((idx = push_node(b, CAFFEINE_JSON_STRING)) < 0) return -1;
+            rc = scan_string(b, idx);
+            break;
+        case '{':
+            if ((idx = push_node(b, CAFFEINE_JSON_OBJECT)) < 0) return -1;
+            rc = parse_container(b, '}');
+            break;
+        case '[':
+            if ((idx = push_node(b, CAFFEINE_JSON_ARRAY)) < 0) return -1;
+            rc = parse_container(b, ']');
+            break;
+        case 't':
+            if ((idx = push_node(b, CAFFEINE_JSON_TRUE)) < 0) return -1;
+            rc = scan_literal(b, "true", 4);
+            break;
+        case 'f':
+            if ((idx = push_node(b, CAFFEINE_JSON_FALSE)) < 0) return -1;
+            rc = scan_literal(b, "false", 5);
+            break;
+        case 'n':
+            if ((idx = push_node(b, CAFFEINE_JSON_NULL)) < 0) return -1;
+            rc = scan_literal(b, "null", 4);
+            break;
+        default:
+            if ((idx = push_node(b, CAFFEINE_JSON_NUMBER)) < 0) return -1;
+            rc = scan_number(b);
+            break;
+    }
+    if (rc < 0) return -1;
+
+    b->nodes[idx].len = (uint32_t)(b->p - start);
+    b->nodes[idx].next = b->count;
+    return 0;
+}
+
+int json_tape_build(arena_t *arena, const char *json, size_t len, caffeine_json_t *doc) {
+    if (len >= UINT32_MAX) {
+        LOG_WARN("json_tape: %zu byte document is too large", len);
+        return -1;
+    }
+
+    tape_builder_t b = {
+        .arena = arena,
+        .src = json,
+        .p = json,
+        .end = json + len,
+        // roughly one value every 16 bytes, grown on demand
+        .cap = (uint32_t)(len / 16 + 16),
+        .depth = 0
+    };
+    b.nodes = arena_alloc(arena, b.cap * sizeof(caffeine_json_node_t));
+    if (!b.nodes) return -1;
+
+    if (parse_value(&b) < 0 || skip_ws(b.p, b.end) != b.end) return -1;
+
+    doc->src = json;
+    doc->src_len = len;
+    doc->nodes = b.nodes;
+    doc->count = b.count;
+    return 0;
+}
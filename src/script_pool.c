@@ -0,0 +1,249 @@
+#define _GNU_SOURCE // memfd_create, close_range
+#include <script_pool.h>
+#include <caffeine_utils.h>
+#include <log.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+static const char* interpreter_of(const char *name) {
+    size_t len = strlen(name);
+    if (len > 3 && !strcmp(name + len - 3, ".sh")) return "bash";
+    if (len > 3 && !strcmp(name + len - 3, ".py")) return "python3";
+    return NULL;
+}
+
+int script_is_name(const char *name) {
+    return interpreter_of(name) != NULL;
+}
+
+script_pool_t* script_pool_new(const char *path) {
+    script_pool_t *pool = calloc(1, sizeof(script_pool_t));
+    if (!pool) return NULL;
+
+    pool->path = strdup(path);
+    pool->interp = interpreter_of(path);
+    if (!pool->path || !pool->interp) {
+        free(pool->path);
+        free(pool);
+        return NULL;
+    }
+    // an interpreter dying mid-request must fail the write, not the worker
+    signal(SIGPIPE, SIG_IGN);
+    return pool;
+}
+
+static void proc_kill(script_proc_t *p) {
+    if (!p->pid) return;
+    kill(p->pid, SIGKILL);
+    waitpid(p->pid, NULL, 0);
+    close(p->in_fd);
+    close(p->out_fd);
+    close(p->shm_fd);
+    p->pid = 0;
+    p->busy = 0;
+}
+
+void script_pool_free(script_pool_t *pool) {
+    if (!pool) return;
+    for (int k = 0; k < SCRIPT_POOL_MAX; k++) proc_kill(&pool->procs[k]);
+    free(pool->path);
+    free(pool);
+}
+
+static int proc_spawn(script_pool_t *pool, script_proc_t *p) {
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0) return -1;
+    if (pipe2(out, O_CLOEXEC) < 0) {
+        close(in[0]);
+        close(in[1]);
+        return -1;
+    }
+    int shm_fd = memfd_create("caffeine-script", MFD_CLOEXEC);
+    pid_t parent = getpid();
+    pid_t pid = shm_fd < 0 ? -1 : fork();
+
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid() != parent) _exit(1);
+        signal(SIGPIPE, SIG_DFL);
+        // dup2() leaves the copies open across exec, everything else the worker holds is closed
+        if (dup2(in[0], 0) < 0 || dup2(out[1], 1) < 0 || dup2(shm_fd, 3) < 0) _exit(1);
+        close_range(4, ~0U, 0);
+        execlp(pool->interp, pool->interp, pool->path, (char *)NULL);
+        _exit(127);
+    }
+
+    close(in[0]);
+    close(out[1]);
+    if (pid < 0) {
+        LOG_ERROR("Cannot start %s for %s: %s", pool->interp, pool->path, strerror(errno));
+        close(in[1]);
+        close(out[0]);
+        if (shm_fd >= 0) close(shm_fd);
+        return -1;
+    }
+
+    // an interpreter that stops reading fails the request instead of blocking the worker
+    fcntl(in[1], F_SETFL, O_NONBLOCK);
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+    p->pid = pid;
+    p->in_fd = in[1];
+    p->out_fd = out[0];
+    p->shm_fd = shm_fd;
+    p->busy = 0;
+    LOG_INFO("Worker %d started %s %s (PID %d)", getpid(), pool->interp, pool->path, pid);
+    return 0;
+}
+
+// an idle interpreter, or a new one while the pool has room
+static script_proc_t* proc_acquire(script_pool_t *pool) {
+    script_proc_t *spare = NULL;
+
+    for (int k = 0; k < SCRIPT_POOL_MAX; k++) {
+        script_proc_t *p = &pool->procs[k];
+        if (p->pid && !p->busy) {
+            if (waitpid(p->pid, NULL, WNOHANG) == 0) return p;
+            LOG_WARN("Interpreter %d for %s exited", p->pid, pool->path);
+            p->pid = 0; // already reaped, only the fds are left
+            close(p->in_fd);
+            close(p->out_fd);
+            close(p->shm_fd);
+        }
+        if (!p->pid && !spare) spare = p;
+    }
+    return spare && proc_spawn(pool, spare) == 0 ? spare : NULL;
+}
+
+static int proc_send(script_proc_t *p, const char *req, size_t len) {
+    char hdr[32];
+    struct iovec iov[2];
+    int inline_frame = len <= SCRIPT_INLINE_MAX;
+
+    if (!inline_frame && pwrite(p->shm_fd, req, len, 0) != (ssize_t)len) return -1;
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = snprintf(hdr, sizeof(hdr), "%s%zu\n", inline_frame ? "" : "@", len);
+    iov[1].iov_base = (void *)req;
+    iov[1].iov_len = inline_frame ? len : 0;
+    return writev_fully(p->in_fd, iov, 2) < 0 ? -1 : 0;
+}
+
+// parses "[@]<length>[ <status>]" and sets up the body, -1 on a malformed frame
+static int proc_frame(caffeine_ctx_t *ctx, script_proc_t *p, char *nl) {
+    char *s = p->hdr, *end;
+    int via_shm = *s == '@';
+
+    *nl = 0;
+    unsigned long long len = strtoull(s + via_shm, &end, 10);
+    if (end == s + via_shm || len > SCRIPT_BODY_MAX) return -1;
+    p->status = 200;
+    if (*end == ' ') {
+        long status = strtol(end + 1, &end, 10);
+        if (status < 100 || status > 599) return -1;
+        p->status = (int)status;
+    }
+    if (*end) return -1;
+
+    p->body_len = len;
+    p->body = caffeine_alloc(ctx, len + 1);
+    if (!p->body) return -1;
+    p->body[len] = 0;
+
+    size_t extra = p->hdr_len - (nl + 1 - p->hdr);
+    if (via_shm) {
+        if (extra || pread(p->shm_fd, p->body, len, 0) != (ssize_t)len) return -1;
+        p->got = len;
+        return 0;
+    }
+    if (extra > len) return -1;
+    memcpy(p->body, nl + 1, extra);
+    p->got = extra;
+    return 0;
+}
+
+// 1 once a whole response is in, 0 to wait for more, -1 on error or EOF
+static int proc_recv(caffeine_ctx_t *ctx, script_proc_t *p) {
+    while (!p->body) {
+        ssize_t n = read(p->out_fd, p->hdr + p->hdr_len, sizeof(p->hdr) - 1 - p->hdr_len);
+        if (n < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        if (n == 0) return -1;
+        p->hdr_len += n;
+
+        char *nl = memchr(p->hdr, '\n', p->hdr_len);
+        if (nl) {
+            if (proc_frame(ctx, p, nl) < 0) return -1;
+        } else if (p->hdr_len == sizeof(p->hdr) - 1) {
+            return -1;
+        }
+    }
+
+    while (p->got < p->body_len) {
+        ssize_t n = read(p->out_fd, p->body + p->got, p->body_len - p->got);
+        if (n < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+        if (n == 0) return -1;
+        p->got += n;
+    }
+    return 1;
+}
+
+static const char* script_error(char *buf, size_t cap, size_t *len, int status, const char *msg) {
+    *len = (size_t)snprintf(buf, cap, "{\"status\":%d,\"body\":\"%s\"}", status, msg);
+    return buf;
+}
+
+static const char* script_resume(caffeine_ctx_t *ctx, char *buf, size_t cap, size_t *len) {
+    script_proc_t *p = ctx->user;
+
+    // timed out, the interpreter may still be busy with it and cannot be reused
+    if (!ctx->ready_events) {
+        proc_kill(p);
+        return NULL;
+    }
+
+    int rc = proc_recv(ctx, p);
+    if (rc == 0 && caffeine_await(ctx, p->out_fd, POLLIN, script_resume) == 0) return CAFFEINE_PENDING;
+    if (rc <= 0) {
+        LOG_ERROR("Interpreter %d sent no valid response", p->pid);
+        proc_kill(p);
+        return script_error(buf, cap, len, 502, "Script handler failed");
+    }
+
+    p->busy = 0;
+    caffeine_raw(ctx, p->status, "application/json");
+    *len = p->body_len;
+    return p->body;
+}
+
+/*
+ * Hands the request to an interpreter of the pool and suspends until it
+ * answers; the worker serves other requests meanwhile. With every
+ * interpreter busy the request gets a 503.
+ */
+const char* script_call(caffeine_ctx_t *ctx, script_pool_t *pool, char *buf, size_t cap, size_t *len) {
+    script_proc_t *p = proc_acquire(pool);
+    if (!p) return script_error(buf, cap, len, 503, "Script handler busy");
+
+    if (proc_send(p, ctx->request, ctx->request_len) < 0) {
+        LOG_ERROR("Cannot pass request to interpreter %d: %s", p->pid, strerror(errno));
+        proc_kill(p);
+        return script_error(buf, cap, len, 502, "Script handler failed");
+    }
+
+    p->busy = 1;
+    p->hdr_len = 0;
+    p->body = NULL;
+    p->body_len = 0;
+    p->got = 0;
+    ctx->user = p;
+    if (caffeine_await(ctx, p->out_fd, POLLIN, script_resume) < 0) {
+        proc_kill(p);
+        return script_error(buf, cap, len, 500, "Internal Server Error");
+    }
+    return CAFFEINE_PENDING;
+}
@@ -74,12 +74,11 @@ static long read_total_jiffies(void) {
 }
 
 static void remove_worker_by_pid(pid_t pid, shm_layout_t* map) {
-    for (int i = 0; i < g_cfg.current_workers; i++) {
-        if (map->workers[i].pid == pid) {
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        if (map->workers[i].used && map->workers[i].pid == pid) {
+            map->workers[i].pid = 0;
+            map->workers[i].state = W_EXIT;
             map->workers[i].used = 0;
-            int last = g_cfg.current_workers - 1;
-            if (i != last)
-                map->workers[i].pid = map->workers[last].pid;
             g_cfg.current_workers--;
             map->worker_count--;
             return;
@@ -93,25 +92,39 @@ void spawn_worker(shm_layout_t* map) {
     if (g_cfg.current_workers >= g_cfg.max_workers)
         return;
 
+    // the slot is claimed here, two children racing for the same one would share it
+    int slot = -1;
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        if (!map->workers[i].used) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0)
+        return;
+
+    // the new worker is not running yet, the supervisor can publish for it
+    map->workers[slot].pid = 0;
+    shm_worker_publish(&map->workers[slot], W_WARMUP, HANDLER_IDX_NONE, 0, now_ms());
+    map->workers[slot].used = 1;
+
     pid_t pid = fork();
     if (pid < 0) {
         LOG_ERROR("fork failed: %s", strerror(errno));
+        map->workers[slot].used = 0;
         return;
     }
 
     if (pid == 0) {
-        shm_worker_t* worker_ptr = NULL;
-        for (int i = 0; i < g_cfg.max_workers; i++) {
-            if (!map->workers[i].used) {
-                map->workers[i].used = 1;
-                map->workers[i].pid = pid;
-                map->workers[i].state = W_IDLE;
-                exec_worker(g_cfg.listen_fd, map, i);
-                break;
-            }
-        }
+        // respawned children inherit the supervisor's blocked SIGTERM/SIGCHLD
+        sigset_t empty;
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, NULL);
+        map->workers[slot].pid = getpid();
+        exec_worker(g_cfg.listen_fd, map, slot);
         _exit(1);
     }
+    map->workers[slot].pid = pid;
     g_cfg.current_workers++;
     map->worker_count++;
     LOG_INFO("worker spawned PID %d", pid);
@@ -154,11 +167,87 @@ void reap_workers(shm_layout_t* map) {
     }
 }
 
+typedef struct {
+    uint64_t        requests, bytes_in, bytes_out, status[5], parse_errors, timeouts, timeout_kills;
+    hist_snapshot_t latency;
+} worker_snapshot_t;
+
+static void snapshot_worker(const shm_worker_t *w, const shm_worker_stats_t *st, worker_snapshot_t *s) {
+    s->requests = atomic_load_explicit(&st->requests, memory_order_relaxed);
+    s->bytes_in = atomic_load_explicit(&st->bytes_in, memory_order_relaxed);
+    s->bytes_out = atomic_load_explicit(&st->bytes_out, memory_order_relaxed);
+    for (int c = 0; c < 5; c++) s->status[c] = atomic_load_explicit(&st->status[c], memory_order_relaxed);
+    s->parse_errors = atomic_load_explicit(&st->parse_errors, memory_order_relaxed);
+    s->timeouts = atomic_load_explicit(&st->timeouts, memory_order_relaxed);
+    s->timeout_kills = atomic_load_explicit(&w->timeout_kills, memory_order_relaxed);
+    hist_snapshot(&st->latency_us, &s->latency);
+}
+
+/*
+ * Logs what the workers did since the last report: one line for the
+ * whole server and, at debug level, one per worker slot that served
+ * anything.
+ */
+static void report_worker_stats(shm_layout_t *map, uint64_t interval_ms) {
+    static worker_snapshot_t last[MAX_WORKERS];
+    static worker_snapshot_t now, delta, total;
+
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        snapshot_worker(&map->workers[i], &map->stats[i], &now);
+        delta.requests = now.requests - last[i].requests;
+        delta.bytes_in = now.bytes_in - last[i].bytes_in;
+        delta.bytes_out = now.bytes_out - last[i].bytes_out;
+        for (int c = 0; c < 5; c++) delta.status[c] = now.status[c] - last[i].status[c];
+        delta.parse_errors = now.parse_errors - last[i].parse_errors;
+        delta.timeouts = now.timeouts - last[i].timeouts;
+        delta.timeout_kills = now.timeout_kills - last[i].timeout_kills;
+        hist_delta(&now.latency, &last[i].latency, &delta.latency);
+        last[i] = now;
+
+        if (!delta.requests && !delta.parse_errors && !delta.timeout_kills) continue;
+        LOG_DEBUG("worker slot %d: %llu requests, 5xx %llu, p50 %.2f ms, p99 %.2f ms", i,
+                  (unsigned long long)delta.requests, (unsigned long long)delta.status[4],
+                  hist_percentile(&delta.latency, 50) / 1000.0, hist_percentile(&delta.latency, 99) / 1000.0);
+
+        total.requests += delta.requests;
+        total.bytes_in += delta.bytes_in;
+        total.bytes_out += delta.bytes_out;
+        for (int c = 0; c < 5; c++) total.status[c] += delta.status[c];
+        total.parse_errors += delta.parse_errors;
+        total.timeouts += delta.timeouts;
+        total.timeout_kills += delta.timeout_kills;
+        hist_merge(&total.latency, &delta.latency);
+    }
+
+    if (!total.requests && !total.parse_errors && !total.timeout_kills) return;
+    double secs = interval_ms / 1000.0;
+    LOG_INFO("%.1f req/s, 2xx %llu 3xx %llu 4xx %llu 5xx %llu, p50 %.2f ms p99 %.2f ms p99.9 %.2f ms, "
+             "%llu timeouts, %llu timeout kills, %llu parse errors, in %.1f kB/s out %.1f kB/s",
+             total.requests / secs, (unsigned long long)total.status[1], (unsigned long long)total.status[2],
+             (unsigned long long)total.status[3], (unsigned long long)total.status[4],
+             hist_percentile(&total.latency, 50) / 1000.0, hist_percentile(&total.latency, 99) / 1000.0,
+             hist_percentile(&total.latency, 99.9) / 1000.0,
+             (unsigned long long)total.timeouts, (unsigned long long)total.timeout_kills,
+             (unsigned long long)total.parse_errors, total.bytes_in / 1024.0 / secs, total.bytes_out / 1024.0 / secs);
+}
+
 void monitor_and_scale(int tfd, shm_layout_t* map) {
     uint64_t expirations;
     if (read(tfd, &expirations, sizeof(expirations)) < 0)
         return;
 
+    // timeouts are checked every tick, scaling only every MONITOR_SCALE_TICKS
+    static uint64_t ticks = 0;
+    ticks += expirations;
+    int scale = ticks >= MONITOR_SCALE_TICKS;
+    if (scale) {
+        ticks = 0;
+        registry_report_canaries(map);
+        registry_report_handlers(map, MONITOR_TICK_MS * MONITOR_SCALE_TICKS);
+        report_worker_stats(map, MONITOR_TICK_MS * MONITOR_SCALE_TICKS);
+    }
+
     int current_cnt = g_cfg.current_workers;
     if (current_cnt == 0)
         return;
@@ -166,33 +255,60 @@ void monitor_and_scale(int tfd, shm_layout_t* map) {
     uint64_t now = now_ms();
     int busy_count = 0;
     int active_workers = 0;
+    int last_slot = -1;
+    int warming = 0;
 
     for (int i = 0; i < MAX_WORKERS; i++) {
         shm_worker_t *w = &map->workers[i];
+        shm_worker_view_t v;
         if (!w->used)
             continue;
+        // caught mid-update, still counts as capacity
+        if (shm_worker_read(w, &v) < 0)
+            v.state = W_IDLE;
+
+        // not accepting yet, neither capacity nor load
+        if (v.state == W_WARMUP) {
+            warming++;
+            if (w->pid > 0 && now - v.start_ms > WARMUP_TIMEOUT_MS) {
+                LOG_ERROR("worker %d did not finish warming up in %d ms", w->pid, WARMUP_TIMEOUT_MS);
+                kill(w->pid, SIGKILL);
+            }
+            continue;
+        }
 
         active_workers++;
+        last_slot = i;
 
-        if (atomic_load(&w->state) == W_BUSY) {
+        if (v.state == W_BUSY) {
             busy_count++;
-            if (now - w->start_ms > map->handlers[w->handler_idx].timeout_ms) {
-                LOG_ERROR("worker %d handler timeout", w->pid);
+            uint32_t idx = v.handler_idx;
+            uint64_t start = v.start_ms;
+            uint32_t timeout = idx < map->handler_count
+                ? atomic_load_explicit(&map->handlers[idx].timeout_ms, memory_order_relaxed)
+                : HANDLER_DEFAULT_TIMEOUT_MS;
+            if (w->pid > 0 && now > start && now - start > timeout) {
+                LOG_ERROR("worker %d handler %s timed out after %u ms", w->pid,
+                          idx < map->handler_count ? map->handlers[idx].name : "?", timeout);
                 kill(w->pid, SIGKILL);
+                shm_counter_add(&w->timeout_kills, 1);
+                if (idx < map->handler_count)
+                    shm_counter_add(&map->handlers[idx].timeout_kills, 1);
                 continue;
             }
         }
     }
 
-    if (active_workers == 0) return;
+    if (active_workers == 0 || !scale) return;
 
     double occupancy_rate = (double)busy_count / active_workers;
 
-    if (occupancy_rate > 0.80 && active_workers < g_cfg.max_workers) {
+    // a worker still warming up is already the answer to the last spike
+    if (occupancy_rate > 0.80 && active_workers < g_cfg.max_workers && !warming) {
         spawn_worker(map);
     } 
     else if (occupancy_rate < 0.20 && active_workers > g_cfg.min_workers) {
-        terminate_worker(map->workers[active_workers - 1].pid);
+        terminate_worker(map->workers[last_slot].pid);
     }
 }
 
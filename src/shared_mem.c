@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // dlmopen
 #include <shared_mem.h>
 #include <sys/mman.h>
 #include <stdlib.h>
@@ -5,10 +6,229 @@
 #include <caffeine_cfg.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 #include <string.h>
+#include <errno.h>
 #include <caffeine_utils.h>
 #include <dlfcn.h>
 #include <log.h>
+#include <script_pool.h>
+
+/*
+ * With --preload the supervisor keeps every handler it registers open, so
+ * workers forked afterwards inherit it relocated and initialised: their
+ * dlopen() of the same path only takes another reference. The table is
+ * process local, each worker sees it as it was when it was forked.
+ */
+typedef struct {
+    void        *handle;
+    uint64_t    version;
+}   preload_t;
+
+static preload_t preloaded[MAX_HANDLERS];
+
+/*
+ * Handlers are found through shm_layout_t.index, an open-addressing table
+ * keyed by hash_name() that only ever gains entries. A slot is published
+ * with a release store after its shm_handler_t is complete, so workers look
+ * names up with plain acquire loads and no lock.
+ */
+int registry_lookup(shm_layout_t *map, const char *name, uint64_t hash) {
+    size_t mask = HANDLER_INDEX_SIZE - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        uint32_t slot = atomic_load_explicit(&map->index[i], memory_order_acquire);
+        if (!slot) return -1;
+
+        shm_handler_t *h = &map->handlers[slot - 1];
+        if (atomic_load_explicit(&h->hash, memory_order_relaxed) == hash && !strcmp(h->name, name)) return slot - 1;
+    }
+}
+
+static void registry_link_canary(shm_layout_t *map, int idx);
+
+// supervisor only
+static int registry_add(shm_layout_t *map, const char *name, const char *so_path, uint32_t timeout_ms, int present) {
+    size_t len = strlen(name);
+    uint64_t hash = hash_name(name, len);
+    int idx = registry_lookup(map, name, hash);
+    if (idx >= 0) {
+        // registered earlier as the base of a canary scanned first, this is the file itself
+        if (present) {
+            atomic_store_explicit(&map->handlers[idx].timeout_ms, timeout_ms, memory_order_relaxed);
+            atomic_store_explicit(&map->handlers[idx].present, 1, memory_order_relaxed);
+        }
+        return idx;
+    }
+
+    if (len >= HANDLER_NAME_MAX) {
+        LOG_WARN("Handler name %s is longer than %d bytes, ignored", name, HANDLER_NAME_MAX - 1);
+        return -1;
+    }
+    if (map->handler_count >= MAX_HANDLERS) {
+        LOG_WARN("Handler registry is full, %s ignored", name);
+        return -1;
+    }
+
+    idx = map->handler_count++;
+    shm_handler_t *h = &map->handlers[idx];
+    memcpy(h->name, name, len + 1);
+    snprintf(h->so_path, sizeof(h->so_path), "%s", so_path);
+    atomic_store_explicit(&h->hash, hash, memory_order_relaxed);
+    atomic_store_explicit(&h->timeout_ms, timeout_ms, memory_order_relaxed);
+    atomic_store_explicit(&h->present, present, memory_order_relaxed);
+    atomic_store_explicit(&h->version, 1, memory_order_relaxed);
+    atomic_store_explicit(&h->weight, CANARY_DEFAULT_WEIGHT, memory_order_relaxed);
+
+    size_t mask = HANDLER_INDEX_SIZE - 1;
+    size_t i = hash & mask;
+    while (atomic_load_explicit(&map->index[i], memory_order_relaxed)) i = (i + 1) & mask;
+    atomic_store_explicit(&map->index[i], idx + 1, memory_order_release);
+
+    if (strchr(name, '@') && !script_is_name(name)) registry_link_canary(map, idx);
+    return idx;
+}
+
+/*
+ * canaries[] only lists versions whose file exists: one that is removed
+ * leaves it and gives its place to the next one deployed. Workers read the
+ * list without a lock, a stale entry they may still see is registered and
+ * skipped as absent.
+ */
+static int find_canary(shm_handler_t *h, int idx) {
+    uint32_t n = atomic_load_explicit(&h->canary_count, memory_order_relaxed);
+    for (uint32_t k = 0; k < n; k++) {
+        if (atomic_load_explicit(&h->canaries[k], memory_order_relaxed) == (uint32_t)idx) return (int)k;
+    }
+    return -1;
+}
+
+// registry index of the name a name@version handler is a canary of, -1 if not registered
+static int canary_base(shm_layout_t *map, int idx) {
+    const char *name = map->handlers[idx].name;
+    size_t base_len = strchr(name, '@') - name;
+    char base[HANDLER_NAME_MAX];
+
+    memcpy(base, name, base_len);
+    base[base_len] = 0;
+    return registry_lookup(map, base, hash_name(base, base_len));
+}
+
+static void registry_unlink_canary(shm_layout_t *map, int idx) {
+    int b = canary_base(map, idx);
+    if (b < 0) return;
+
+    shm_handler_t *h = &map->handlers[b];
+    int k = find_canary(h, idx);
+    if (k < 0) return;
+    uint32_t n = atomic_load_explicit(&h->canary_count, memory_order_relaxed);
+    atomic_store_explicit(&h->canaries[k], atomic_load_explicit(&h->canaries[n - 1], memory_order_relaxed),
+                          memory_order_relaxed);
+    atomic_store_explicit(&h->canary_count, n - 1, memory_order_release);
+}
+
+// lists name@version under name, registering name as absent if it is not known yet
+static void registry_link_canary(shm_layout_t *map, int idx) {
+    const char *name = map->handlers[idx].name;
+    size_t base_len = strchr(name, '@') - name;
+    char base[HANDLER_NAME_MAX];
+    char so_path[512];
+    struct stat st;
+
+    if (!base_len) return;
+    memcpy(base, name, base_len);
+    base[base_len] = 0;
+    snprintf(so_path, sizeof(so_path), "%s%s.so", g_cfg.exec_path, base);
+
+    // an already registered base keeps the timeout it was registered with
+    int b = registry_lookup(map, base, hash_name(base, base_len));
+    if (b < 0) b = registry_add(map, base, so_path, HANDLER_DEFAULT_TIMEOUT_MS, stat(so_path, &st) == 0);
+    if (b < 0) return;
+
+    shm_handler_t *h = &map->handlers[b];
+    if (find_canary(h, idx) >= 0) return;
+    uint32_t n = atomic_load_explicit(&h->canary_count, memory_order_relaxed);
+    if (n >= HANDLER_MAX_CANARIES) {
+        LOG_WARN("%s already has %d canaries, %s is only reachable by name", base, HANDLER_MAX_CANARIES, name);
+        return;
+    }
+    atomic_store_explicit(&h->canaries[n], idx, memory_order_relaxed);
+    atomic_store_explicit(&h->canary_count, n + 1, memory_order_release);
+}
+
+/*
+ * Reads canary_weight_val of name@version. Workers scale the weights of a
+ * name's present canaries down when they add up to more than 100, which
+ * leaves nothing for name itself, so that is worth a warning.
+ */
+static void set_canary_weight(shm_layout_t *map, int idx, void *dl_handle) {
+    int *w_ptr = (int *)dlsym(dl_handle, "canary_weight_val");
+    int weight = w_ptr ? *w_ptr : CANARY_DEFAULT_WEIGHT;
+    if (weight < 0) weight = 0;
+    if (weight > 100) weight = 100;
+    atomic_store_explicit(&map->handlers[idx].weight, weight, memory_order_relaxed);
+
+    int b = canary_base(map, idx);
+    if (b < 0) return;
+    shm_handler_t *h = &map->handlers[b];
+    uint32_t n = atomic_load_explicit(&h->canary_count, memory_order_relaxed), total = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        shm_handler_t *c = &map->handlers[atomic_load_explicit(&h->canaries[k], memory_order_relaxed)];
+        if (atomic_load_explicit(&c->present, memory_order_relaxed))
+            total += atomic_load_explicit(&c->weight, memory_order_relaxed);
+    }
+    if (total > 100) {
+        LOG_WARN("canaries of %s add up to %u%%, they are scaled down to 100%% and %s gets no traffic",
+                 h->name, total, h->name);
+    }
+}
+
+// supervisor only, swaps the preloaded handle for the current file
+static void preload_handler(shm_layout_t *map, int idx) {
+    shm_handler_t *reg = &map->handlers[idx];
+    preload_t *p = &preloaded[idx];
+
+    // versions get a namespace of their own in each worker, nothing to share
+    if (strchr(reg->name, '@') || script_is_name(reg->name)) return;
+    if (p->handle) dlclose(p->handle);
+    p->handle = NULL;
+    if (!atomic_load_explicit(&reg->present, memory_order_relaxed)) return;
+
+    p->handle = dlopen(reg->so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!p->handle) {
+        LOG_ERROR("preload of %s failed: %s", reg->so_path, dlerror());
+        return;
+    }
+    int *t_ptr = (int *)dlsym(p->handle, "timeout_val");
+    if (t_ptr) atomic_store_explicit(&reg->timeout_ms, *t_ptr, memory_order_relaxed);
+    p->version = atomic_load_explicit(&reg->version, memory_order_relaxed);
+}
+
+/*
+ * Called by a worker about to load another version of a handler: drops the
+ * reference inherited from the supervisor, otherwise dlopen() would hand
+ * back the old object for a file rewritten in place.
+ */
+void registry_release_preloaded(uint32_t idx, uint64_t version) {
+    preload_t *p = &preloaded[idx];
+    if (p->handle && p->version != version) {
+        dlclose(p->handle);
+        p->handle = NULL;
+    }
+}
+
+// strips ".so", scripts keep their extension; returns 0 when d_name is not a handler
+static int handler_name_of(const char *d_name, char *name) {
+    size_t len = strlen(d_name);
+    if (script_is_name(d_name) && len < HANDLER_NAME_MAX) {
+        memcpy(name, d_name, len + 1);
+        return 1;
+    }
+    if (len <= 3 || len - 3 >= HANDLER_NAME_MAX || strcmp(d_name + len - 3, ".so")) return 0;
+    memcpy(name, d_name, len - 3);
+    name[len - 3] = 0;
+    return 1;
+}
 
 static void map_handler(shm_layout_t* map, char* path)
 {
@@ -16,6 +236,7 @@ static void map_handler(shm_layout_t* map, char* path)
     struct dirent *en;
     struct stat st; 
     char full_path[512];
+    char name[HANDLER_NAME_MAX];
 
     dr = opendir(path);
 
@@ -29,7 +250,7 @@ static void map_handler(shm_layout_t* map, char* path)
             continue;
         }
 
-        if (strcmp(&en->d_name[strlen(en->d_name) - 3], ".so") != 0) {
+        if (!handler_name_of(en->d_name, name)) {
             continue;
         }
         snprintf(full_path, sizeof(full_path), "%s/%s", path, en->d_name);
@@ -42,34 +263,276 @@ static void map_handler(shm_layout_t* map, char* path)
         if (S_ISDIR(st.st_mode)) {
             map_handler(map, full_path);
             printf("Directory: %s\n", en->d_name);
+        } else if (script_is_name(name)) {
+            registry_add(map, name, full_path, HANDLER_DEFAULT_TIMEOUT_MS, 1);
         } else {
             void *h = dlopen(full_path, RTLD_NOW | RTLD_LOCAL);
             if (!h) {
                 LOG_ERROR("dlopen failed: %s", dlerror());
-                return ;
+                continue;
             }
             int *t_ptr = (int *)dlsym(h, "timeout_val");
-            unsigned long path_hash = hash_path(en->d_name);
-            memset(map->handlers[map->handler_count].so_path, 0, 512);
-            strncpy((char*)map->handlers[map->handler_count].so_path, full_path, 511);
-            map->handlers[map->handler_count].hash = path_hash;
-            map->handlers[map->handler_count].timeout_ms = t_ptr ? *t_ptr : 5000;
-            map->handler_count++;
-            dlclose(h);
+            int idx = registry_add(map, name, full_path, t_ptr ? *t_ptr : HANDLER_DEFAULT_TIMEOUT_MS, 1);
+            if (idx >= 0 && strchr(name, '@')) set_canary_weight(map, idx, h);
+            if (g_cfg.preload && idx >= 0 && !preloaded[idx].handle && !strchr(name, '@')) {
+                preloaded[idx].handle = h;
+                preloaded[idx].version = atomic_load_explicit(&map->handlers[idx].version, memory_order_relaxed);
+            } else {
+                dlclose(h);
+            }
         }
     }
     closedir(dr);
 }
 
-void* create_shared_map()
-{
-    shm_layout_t* map = mmap(NULL, sizeof(shm_layout_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-    if (map == MAP_FAILED) {
+/*
+ * Re-reads one handler's file after an event and publishes the change.
+ * complete is set once the file is fully written, only then is it worth
+ * preloading.
+ */
+static void registry_refresh(shm_layout_t *map, const char *name, int complete) {
+    char so_path[512];
+    struct stat st;
+
+    snprintf(so_path, sizeof(so_path), "%s%s%s", g_cfg.exec_path, name, script_is_name(name) ? "" : ".so");
+    int present = stat(so_path, &st) == 0 && S_ISREG(st.st_mode);
+
+    int idx = registry_lookup(map, name, hash_name(name, strlen(name)));
+    if (idx < 0) {
+        // timeout_val is picked up by the first worker that loads it
+        if (present) idx = registry_add(map, name, so_path, HANDLER_DEFAULT_TIMEOUT_MS, 1);
+    } else {
+        shm_handler_t *h = &map->handlers[idx];
+        atomic_store_explicit(&h->present, present, memory_order_relaxed);
+        atomic_store_explicit(&h->changed_ms, now_ms(), memory_order_relaxed);
+        atomic_fetch_add_explicit(&h->version, 1, memory_order_release);
+    }
+
+    if (idx < 0) return;
+    if (strchr(name, '@') && !script_is_name(name)) {
+        if (present) registry_link_canary(map, idx);
+        else registry_unlink_canary(map, idx);
+    }
+    if (g_cfg.preload && (complete || !present)) preload_handler(map, idx);
+    if (complete && present && strchr(name, '@') && !script_is_name(name)) {
+        // a namespace of its own so reading the weight cannot clash with anything loaded here
+        void *h = dlmopen(LM_ID_NEWLM, so_path, RTLD_NOW | RTLD_LOCAL);
+        if (!h) {
+            LOG_ERROR("dlmopen failed: %s", dlerror());
+            return;
+        }
+        set_canary_weight(map, idx, h);
+        dlclose(h);
+    }
+}
+
+static void registry_sync(shm_layout_t *map) {
+    char name[HANDLER_NAME_MAX];
+    DIR *dr = opendir(g_cfg.exec_path);
+    if (!dr) return;
+
+    struct dirent *en;
+    while ((en = readdir(dr)) != NULL) {
+        if (handler_name_of(en->d_name, name) && registry_lookup(map, name, hash_name(name, strlen(name))) < 0)
+            registry_refresh(map, name, 1);
+    }
+    closedir(dr);
+}
+
+/*
+ * Watches exec_path for the supervisor. Returns the inotify fd to poll, or
+ * -1 when the directory cannot be watched, in which case workers keep
+ * stat()ing handlers on every request.
+ */
+int registry_watch(shm_layout_t *map) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, g_cfg.exec_path,
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE) < 0) {
+        LOG_WARN("Cannot watch %s (%s), handlers are stat()ed on every request", g_cfg.exec_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    // catch anything deployed between the startup scan and the watch
+    registry_sync(map);
+    atomic_store_explicit(&map->watched, 1, memory_order_release);
+    return fd;
+}
+
+void registry_handle_events(int fd, shm_layout_t *map) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char name[HANDLER_NAME_MAX];
+
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+
+        for (char *p = buf; p < buf + n; ) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                for (uint32_t i = 0; i < map->handler_count; i++) registry_refresh(map, map->handlers[i].name, 1);
+                registry_sync(map);
+                continue;
+            }
+            if (!ev->len || !handler_name_of(ev->name, name)) continue;
+            if (ev->mask & IN_CREATE) {
+                // still being written, only its IN_CLOSE_WRITE publishes a version
+                char so_path[512];
+                snprintf(so_path, sizeof(so_path), "%s%s%s", g_cfg.exec_path, name, script_is_name(name) ? "" : ".so");
+                registry_add(map, name, so_path, HANDLER_DEFAULT_TIMEOUT_MS, 0);
+            } else {
+                registry_refresh(map, name, (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0);
+            }
+        }
+    }
+}
+
+typedef struct {
+    uint64_t        calls, errors, latency_us, timeout_kills, cpu_ns, bytes_out;
+}   handler_totals_t;
+
+// adds up what every worker slot counted for handler idx, slots keep counting across respawns
+static void handler_totals(shm_layout_t *map, uint32_t idx, handler_totals_t *t) {
+    memset(t, 0, sizeof(*t));
+    for (uint32_t i = 0; i < map->stats_slots; i++) {
+        shm_handler_stats_t *hs = shm_handler_stats(map, i, idx);
+        t->calls += atomic_load_explicit(&hs->calls, memory_order_relaxed);
+        t->errors += atomic_load_explicit(&hs->errors, memory_order_relaxed);
+        t->latency_us += atomic_load_explicit(&hs->latency_us, memory_order_relaxed);
+        t->cpu_ns += atomic_load_explicit(&hs->cpu_ns, memory_order_relaxed);
+        t->bytes_out += atomic_load_explicit(&hs->bytes_out, memory_order_relaxed);
+    }
+    t->timeout_kills = atomic_load_explicit(&map->handlers[idx].timeout_kills, memory_order_relaxed);
+}
+
+// only the slots that ever ran idx, the others' histogram pages stay untouched
+static void handler_latency(shm_layout_t *map, uint32_t idx, hist_snapshot_t *out) {
+    memset(out, 0, sizeof(*out));
+    for (uint32_t i = 0; i < map->stats_slots; i++) {
+        if (!atomic_load_explicit(&shm_handler_stats(map, i, idx)->calls, memory_order_relaxed)) continue;
+        hist_coarse_merge(out, shm_handler_latency(map, i, idx));
+    }
+}
+
+/*
+ * Logs every handler that has canaries next to its versions, with what
+ * each did since the last report, so a regression shows up before a
+ * version takes all the traffic.
+ */
+void registry_report_canaries(shm_layout_t *map) {
+    static handler_totals_t last[MAX_HANDLERS];
+
+    for (uint32_t i = 0; i < map->handler_count; i++) {
+        uint32_t n = atomic_load_explicit(&map->handlers[i].canary_count, memory_order_acquire);
+        if (!n) continue;
+
+        for (uint32_t k = 0; k <= n; k++) {
+            uint32_t idx = k ? atomic_load_explicit(&map->handlers[i].canaries[k - 1], memory_order_relaxed) : i;
+            handler_totals_t now;
+            handler_totals(map, idx, &now);
+            uint64_t dc = now.calls - last[idx].calls;
+
+            if (dc) {
+                LOG_INFO("%s %s: %llu calls, %.1f%% errors, %.2f ms avg%s", k ? "canary" : "handler",
+                         map->handlers[idx].name, (unsigned long long)dc,
+                         100.0 * (now.errors - last[idx].errors) / dc,
+                         (now.latency_us - last[idx].latency_us) / 1000.0 / dc,
+                         k ? "" : " (base version)");
+            }
+            last[idx] = now;
+        }
+    }
+}
+
+#define HANDLER_REPORT_TOP 5
+
+/*
+ * Logs the handlers that used the most CPU since the last report, with
+ * their share of the CPU all handlers used, so the expensive ones stand out
+ * among hundreds of cheap ones.
+ */
+void registry_report_handlers(shm_layout_t *map, uint64_t interval_ms) {
+    static handler_totals_t last[MAX_HANDLERS], now[MAX_HANDLERS];
+    static hist_snapshot_t last_latency[MAX_HANDLERS];
+    static hist_snapshot_t now_hist, delta_hist;
+    uint32_t top[HANDLER_REPORT_TOP];
+    uint64_t top_cpu[HANDLER_REPORT_TOP], top_calls[HANDLER_REPORT_TOP];
+    uint64_t total_cpu = 0;
+    int ntop = 0;
+
+    uint32_t count = map->handler_count;
+    for (uint32_t i = 0; i < count; i++) {
+        handler_totals(map, i, &now[i]);
+        uint64_t cpu = now[i].cpu_ns - last[i].cpu_ns;
+        uint64_t calls = now[i].calls - last[i].calls;
+        if (now[i].calls == last[i].calls && now[i].timeout_kills == last[i].timeout_kills) continue;
+        total_cpu += cpu;
+
+        // insertion into the top list, kept sorted by CPU time and then by
+        // calls, so handlers served from the static cache (no CPU) still rank
+        int pos = ntop < HANDLER_REPORT_TOP ? ntop++ : HANDLER_REPORT_TOP;
+        while (pos > 0 && (top_cpu[pos - 1] < cpu || (top_cpu[pos - 1] == cpu && top_calls[pos - 1] < calls))) {
+            if (pos < HANDLER_REPORT_TOP) {
+                top[pos] = top[pos - 1];
+                top_cpu[pos] = top_cpu[pos - 1];
+                top_calls[pos] = top_calls[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < HANDLER_REPORT_TOP) {
+            top[pos] = i;
+            top_cpu[pos] = cpu;
+            top_calls[pos] = calls;
+        }
+    }
+
+    for (int k = 0; k < ntop; k++) {
+        uint32_t i = top[k];
+        handler_latency(map, i, &now_hist);
+        hist_delta(&now_hist, &last_latency[i], &delta_hist);
+        uint64_t calls = now[i].calls - last[i].calls;
+
+        LOG_INFO("handler %s: %llu calls, %.1f ms CPU (%.1f%% of handler CPU, %.1f%% of a core), "
+                 "%.1f us CPU/call, p50 %.2f ms p99 %.2f ms, %llu errors, %llu timeout kills, %.1f kB out",
+                 map->handlers[i].name, (unsigned long long)calls, top_cpu[k] / 1e6,
+                 total_cpu ? 100.0 * top_cpu[k] / total_cpu : 0.0, top_cpu[k] / 1e4 / interval_ms,
+                 calls ? top_cpu[k] / 1e3 / calls : 0.0,
+                 hist_percentile(&delta_hist, 50) / 1000.0, hist_percentile(&delta_hist, 99) / 1000.0,
+                 (unsigned long long)(now[i].errors - last[i].errors),
+                 (unsigned long long)(now[i].timeout_kills - last[i].timeout_kills),
+                 (now[i].bytes_out - last[i].bytes_out) / 1024.0);
+    }
+
+    // every handler moves on, reported or not, so the next report covers one interval
+    for (uint32_t i = 0; i < count; i++) {
+        if (now[i].calls == last[i].calls && now[i].timeout_kills == last[i].timeout_kills) continue;
+        last[i] = now[i];
+        handler_latency(map, i, &last_latency[i]);
+    }
+}
+
+static void* map_shared(size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
         perror("mmap failed");
         exit(1);
     }
+    return p;
+}
 
-    map->worker_count = g_cfg.min_workers;
+void* create_shared_map()
+{
+    shm_layout_t* map = map_shared(sizeof(shm_layout_t));
+
+    // workers take the lowest free slot and there are never more than max_workers
+    map->stats_slots = (uint32_t)g_cfg.max_workers;
+    size_t rows = (size_t)map->stats_slots * MAX_HANDLERS;
+    map->handler_stats = map_shared(rows * sizeof(shm_handler_stats_t));
+    map->handler_latency = map_shared(rows * sizeof(hist_coarse_t));
+
+    map->worker_count = 0;
     map_handler(map, g_cfg.exec_path);
     return map;
-}
\ No newline at end of file
+}
@@ -6,6 +6,13 @@
 #include <log.h>
 #include <response.h>
 #include <headers.h>
+#include <arena.h>
+#include <guard_buf.h>
+#include <envelope.h>
+#include <json_tape.h>
+#include <handler_cache.h>
+#include <hugepage.h>
+#include <script_pool.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -17,7 +24,9 @@
 #include <pthread.h>
 #include <time.h>
 #include <cJSON.h>
+#include <cJSON_Utils.h>
 #include <sys/timerfd.h>
+#include <sys/epoll.h>
 #include <assert.h>
 
 #define TIMEOUT -2
@@ -49,141 +58,1108 @@ void worker_redirect_logs() {
     LOG_INFO("Worker successfully forced redirection of STDOUT/STDERR to log file.");
 }
 
-int load_handler(handler_entry_t *entry, const char *so_path, struct stat *st, unsigned long path_hash) {
+/*
+ * Every loaded name@version, current or retired, holds a dlmopen() namespace
+ * until it is unloaded. glibc has 15 besides the base one per process, and
+ * each copy of libc loaded into one takes static TLS that is not given back
+ * on unload, which with the default tunables runs out after about ten. So
+ * canaries past HANDLER_MAX_NAMESPACES are not loaded and their share stays
+ * on name; once reloads have used up the static TLS, dlmopen() fails and
+ * says so, with the same fallback.
+ */
+static int g_namespaces;
+
+static void unload_handler(handler_entry_t *entry) {
+    if (entry->so_fd >= 0) close(entry->so_fd);
+    entry->so_fd = -1;
+    if (!entry->dl_handle && !entry->script) return;
+
     if (entry->dl_handle) {
         dlclose(entry->dl_handle);
-        if (entry->path) free(entry->path);
+        if (strchr(entry->name, '@')) g_namespaces--;
+    }
+    entry->dl_handle = NULL;
+    script_pool_free(entry->script);
+    entry->script = NULL;
+    entry->func = NULL;
+    entry->ctx_func = NULL;
+    entry->batch_func = NULL;
+    free(entry->path);
+    entry->path = NULL;
+    free(entry->static_resp);
+    entry->static_resp = NULL;
+    delta_history_free(entry->delta);
+    entry->delta = NULL;
+}
+
+/*
+ * dlopen() hands back an object already loaded under the same path, so a
+ * new generation loaded while an older one is still referenced goes
+ * through /proc/self/fd instead. The fd stays open as long as the
+ * generation does, which keeps that name unique.
+ */
+static int handler_path_busy(handler_cache_t *cache, const char *name) {
+    if (strchr(name, '@')) return 0;
+    for (handler_entry_t *e = cache->retired; e; e = e->next_retired) {
+        if (!strcmp(e->name, name)) return 1;
+    }
+    return 0;
+}
+
+int load_handler(handler_entry_t *entry, const char *so_path, struct stat *st, int unique_name) {
+    char fd_path[32];
+    const char *open_path = so_path;
+
+    unload_handler(entry);
+    if (unique_name) {
+        entry->so_fd = open(so_path, O_RDONLY | O_CLOEXEC);
+        if (entry->so_fd < 0) {
+            LOG_ERROR("open %s failed: %s", so_path, strerror(errno));
+            return -1;
+        }
+        snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", entry->so_fd);
+        open_path = fd_path;
     }
 
-    void *h = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    // name@version runs next to name, its own namespace keeps their symbols and libraries apart
+    int own_ns = strchr(entry->name, '@') != NULL;
+    if (own_ns && g_namespaces >= HANDLER_MAX_NAMESPACES) {
+        LOG_WARN("%d canary namespaces already in use, %s is not loaded and its traffic stays on the base",
+                 g_namespaces, entry->name);
+        unload_handler(entry);
+        return -1;
+    }
+    void *h = own_ns ? dlmopen(LM_ID_NEWLM, open_path, RTLD_NOW | RTLD_LOCAL)
+                     : dlopen(open_path, RTLD_NOW | RTLD_LOCAL);
     if (!h) {
         LOG_ERROR("dlopen failed: %s", dlerror());
+        unload_handler(entry);
         return -1;
     }
 
+    handler_ctx_func cf = (handler_ctx_func)dlsym(h, "handler_ctx");
+    handler_batch_func bf = (handler_batch_func)dlsym(h, "handler_batch");
     handler_func f = (handler_func)dlsym(h, "handler");
-    if (!f) {
+    if (!f && !cf && !bf) {
         LOG_ERROR("Symbol 'handler' not found in %s", so_path);
         dlclose(h);
+        unload_handler(entry);
         return -1;
     }
+    if (own_ns) g_namespaces++;
 
     int *t_ptr = (int *)dlsym(h, "timeout_val");
+    int *s_ptr = (int *)dlsym(h, "static_val");
+    int *ttl_ptr = (int *)dlsym(h, "static_ttl_val");
+    const char **ct_ptr = (const char **)dlsym(h, "content_type_val");
+    int *dv_ptr = (int *)dlsym(h, "delta_versions_val");
     
     entry->dl_handle = h;
     entry->func = f;
+    entry->ctx_func = cf;
+    entry->batch_func = bf;
     entry->path = strdup(so_path);
-    entry->hash = path_hash;
     entry->last_mtime = st->st_mtime;
     entry->timeout_ms = t_ptr ? *t_ptr : 5000; 
+    entry->static_ttl_ms = ttl_ptr ? *ttl_ptr : 0;
+    entry->is_static = (s_ptr && *s_ptr) || entry->static_ttl_ms > 0;
+    entry->raw_content_type = ct_ptr ? *ct_ptr : NULL;
+    entry->delta = (dv_ptr && *dv_ptr > 0) ? delta_history_new(*dv_ptr) : NULL;
+
+    if (g_cfg.hugepages) hugepage_text(h);
+
+    // one-time lazy init of the handler, before it sees a request
+    void (*warmup)(void) = (void (*)(void))dlsym(h, "handler_warmup");
+    if (warmup) warmup();
 
     return 0;
 }
 
-handler_entry_t* get_handler_from_cache(handler_cache_t *cache, const char *handler_name, unsigned long path_hash) {
+// a script handler starts its interpreters on first use, see script_pool.h
+static int load_script(handler_entry_t *entry, const char *path, struct stat *st) {
+    unload_handler(entry);
+    entry->script = script_pool_new(path);
+    if (!entry->script) {
+        LOG_ERROR("Cannot set up script handler %s", path);
+        return -1;
+    }
+    entry->path = strdup(path);
+    entry->last_mtime = st->st_mtime;
+    entry->timeout_ms = HANDLER_DEFAULT_TIMEOUT_MS;
+    entry->static_ttl_ms = 0;
+    entry->is_static = 0;
+    entry->raw_content_type = NULL;
+    entry->delta = NULL;
+    return 0;
+}
+
+static int handler_loaded(handler_entry_t *entry) {
+    return entry->dl_handle || entry->script;
+}
+
+static shm_worker_t *g_self;
+
+// publishes this worker's huge page usage in its shm slot
+static void report_hugepages(void) {
+    size_t anon_kb, file_kb;
+    if (!g_cfg.hugepages || !g_self || hugepage_usage(&anon_kb, &file_kb) < 0) return;
+
+    atomic_store_explicit(&g_self->anon_huge_kb, (uint32_t)anon_kb, memory_order_relaxed);
+    atomic_store_explicit(&g_self->file_huge_kb, (uint32_t)file_kb, memory_order_relaxed);
+    LOG_DEBUG("Worker %d huge pages: %zu kB anonymous, %zu kB file backed", getpid(), anon_kb, file_kb);
+}
+
+/*
+ * The supervisor owns the handler registry in shm: it watches exec_path,
+ * registers new .so files and bumps a handler's version whenever its file
+ * changes. With the watch in place (map->watched) a hit is a version
+ * compare and a name the registry does not know is a 404 without any
+ * syscall. Otherwise the .so is stat()ed on every request.
+ *
+ * A replaced file stays mapped, so after a deploy each worker keeps serving
+ * the version it has for cache->reload_delay_ms (its slot times
+ * HANDLER_RELOAD_STAGGER_MS) instead of every worker reloading at once.
+ */
+handler_entry_t* get_handler_from_cache(shm_layout_t *map, handler_cache_t *cache, const char *handler_name) {
+    uint64_t hash = hash_name(handler_name, strlen(handler_name));
+    handler_entry_t *entry = handler_cache_find(cache, handler_name, hash);
+    int watched = atomic_load_explicit(&map->watched, memory_order_acquire);
+    shm_handler_t *reg = NULL;
+
+    if (entry && entry->shm_idx != HANDLER_IDX_NONE) {
+        reg = &map->handlers[entry->shm_idx];
+        if (watched && atomic_load_explicit(&reg->version, memory_order_acquire) == entry->loaded_version) {
+            return handler_loaded(entry) ? entry : NULL;
+        }
+        if (watched && handler_loaded(entry) && atomic_load_explicit(&reg->present, memory_order_relaxed) &&
+            now_ms() < atomic_load_explicit(&reg->changed_ms, memory_order_relaxed) + cache->reload_delay_ms) {
+            return entry;
+        }
+    } else if (!entry || watched) {
+        int idx = registry_lookup(map, handler_name, hash);
+        if (idx >= 0) reg = &map->handlers[idx];
+        else if (watched) return NULL;
+    }
+
     char full_path[1024];
-    snprintf(full_path, sizeof(full_path), "%s%s.so", g_cfg.exec_path, handler_name);
+    if (reg) snprintf(full_path, sizeof(full_path), "%s", reg->so_path);
+    else snprintf(full_path, sizeof(full_path), "%s%s%s", g_cfg.exec_path, handler_name, script_is_name(handler_name) ? "" : ".so");
+    // read before looking at the file, a change after this bumps it again
+    uint64_t version = reg ? atomic_load_explicit(&reg->version, memory_order_acquire) : 0;
 
     struct stat st;
-    if (stat(full_path, &st) < 0) {
+    int found = (!watched || atomic_load_explicit(&reg->present, memory_order_relaxed)) && stat(full_path, &st) == 0;
+    if (!entry) {
+        if (!found && !reg) return NULL;
+        entry = handler_cache_insert(cache, handler_name, hash);
+        if (!entry) return NULL;
+    } else if (handler_loaded(entry) && found && !watched && entry->last_mtime == st.st_mtime) {
+        return entry;
+    } else if (handler_loaded(entry) && entry->refs) {
+        // parked or batched requests still run this generation, leave it loaded
+        entry = handler_cache_retire(cache, entry);
+        if (!entry) return NULL;
+    }
+    entry->shm_idx = reg ? (uint32_t)(reg - map->handlers) : HANDLER_IDX_NONE;
+    entry->loaded_version = version;
+
+    if (!found) {
+        unload_handler(entry);
         return NULL;
     }
+    if (script_is_name(handler_name)) {
+        if (load_script(entry, full_path, &st) != 0) return NULL;
+        return entry;
+    }
+    if (reg) registry_release_preloaded(entry->shm_idx, version);
+    if (load_handler(entry, full_path, &st, handler_path_busy(cache, handler_name)) != 0) return NULL;
+    report_hugepages();
 
-    for (size_t i = 0; i < cache->size; i++) {
-        if (cache->entries[i].hash == path_hash) {
-            if (cache->entries[i].last_mtime != st.st_mtime) {
-                if (load_handler(&cache->entries[i], full_path, &st, path_hash) != 0) return NULL;
-            }
-            return &cache->entries[i];
+    // timeout_val is only known once loaded, the supervisor enforces it from here
+    if (reg) atomic_store_explicit(&reg->timeout_ms, (uint32_t)entry->timeout_ms, memory_order_relaxed);
+    return entry;
+}
+
+/*
+ * Picks the version a request runs. Each name@version listed as a canary
+ * of name takes its weight percent of the requests, the rest stay on name.
+ * When the present canaries add up to more than 100 they share all the
+ * requests in proportion to their weights. A canary that fails to load
+ * falls back to name.
+ */
+static handler_entry_t* route_handler(shm_layout_t *map, handler_cache_t *cache, const char *handler_name, uint64_t *rng) {
+    handler_entry_t *entry = get_handler_from_cache(map, cache, handler_name);
+    if (!entry || entry->shm_idx == HANDLER_IDX_NONE) return entry;
+
+    shm_handler_t *reg = &map->handlers[entry->shm_idx];
+    uint32_t n = atomic_load_explicit(&reg->canary_count, memory_order_acquire);
+    if (!n) return entry;
+
+    uint32_t total = 0, acc = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        shm_handler_t *c = &map->handlers[atomic_load_explicit(&reg->canaries[k], memory_order_relaxed)];
+        if (atomic_load_explicit(&c->present, memory_order_relaxed))
+            total += atomic_load_explicit(&c->weight, memory_order_relaxed);
+    }
+
+    // xorshift64, good enough to split traffic
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 7;
+    *rng ^= *rng << 17;
+    uint32_t roll = (uint32_t)(*rng % (total > 100 ? total : 100));
+
+    for (uint32_t k = 0; k < n; k++) {
+        shm_handler_t *c = &map->handlers[atomic_load_explicit(&reg->canaries[k], memory_order_relaxed)];
+        if (!atomic_load_explicit(&c->present, memory_order_relaxed)) continue;
+        acc += atomic_load_explicit(&c->weight, memory_order_relaxed);
+        if (roll < acc) {
+            handler_entry_t *canary = get_handler_from_cache(map, cache, c->name);
+            return canary ? canary : entry;
         }
     }
+    return entry;
+}
+
+// unloads a retired generation once its last request is gone
+static void handler_put(handler_cache_t *cache, handler_entry_t *entry) {
+    if (--entry->refs || !entry->retired) return;
+
+    handler_entry_t **p = &cache->retired;
+    while (*p != entry) p = &(*p)->next_retired;
+    *p = entry->next_retired;
+    unload_handler(entry);
+    free(entry);
+}
+
+#define MAX_EVENTS 64
+#define MAX_BATCH 32
+#define OUT_HDR_GAP 256
+#define MAX_GROW_ATTEMPTS 2
+#define HEADER_TIMEOUT_MS 5000
+
+typedef struct arena_node_s {
+    arena_t             arena;
+    int                 parked;
+    struct arena_node_s *next;
+}   arena_node_t;
+
+typedef struct request_s request_t;
+typedef struct client_s client_t;
+
+// what a non-NULL epoll data.ptr points at, both start with it
+typedef enum { EV_REQUEST, EV_CLIENT } ev_kind_t;
+
+typedef struct {
+    shm_layout_t    *map;
+    int             slot;
+    int             epfd;
+    int             listen_fd;
+    handler_cache_t cache;
+    arena_node_t    *arena;
+    arena_node_t    *free_arenas;
+    request_t       *pending;
+    size_t          pending_count;
+    client_t        *reading;
+    client_t        *free_clients;
+    request_t       *ready[MAX_BATCH];
+    size_t          ready_count;
+    guard_buf_t     resp;
+    guard_buf_t     out;
+    arena_t         json_arena;
+    uint64_t        rng;
+}   worker_t;
+
+struct request_s {
+    ev_kind_t           kind;
+    caffeine_ctx_t      ctx;
+    worker_t            *w;
+    arena_node_t        *arena;
+    handler_entry_t     *entry;
+    uint8_t             capture;
+    uint8_t             wants_patch;
+    uint64_t            delta_key;
+    uint64_t            client_etag;
+    uint64_t            start_us;
+    int                 status; // 500 until a response is sent
+    size_t              bytes_in;
+    size_t              bytes_out;
+    uint64_t            cpu_ns; // spent in the handler so far
+    const char          *extra_headers;
+    int                 client_fd;
+    int                 await_fd;
+    unsigned int        await_events;
+    caffeine_cont_func  cont;
+    uint64_t            deadline_ms;
+    request_t           *prev;
+    request_t           *next;
+};
+
+/*
+ * A connection whose request headers have not all arrived when it was
+ * accepted. It waits in epoll for the rest instead of holding up the
+ * worker, until HEADER_TIMEOUT_MS after the accept.
+ */
+struct client_s {
+    ev_kind_t   kind;
+    int         client_fd;
+    uint64_t    start_us;
+    uint64_t    deadline_ms;
+    client_t    *prev;
+    client_t    *next;
+    headers_t   hdrs;
+};
+
+static arena_node_t* arena_node_get(worker_t *w) {
+    arena_node_t *n = w->free_arenas;
+    if (n) {
+        w->free_arenas = n->next;
+        n->next = NULL;
+        return n;
+    }
 
-    if (cache->size >= cache->capacity) {
-        cache->capacity = (cache->capacity == 0) ? 64 : cache->capacity * 2;
-        cache->entries = realloc(cache->entries, sizeof(handler_entry_t) * cache->capacity);
+    n = calloc(1, sizeof(arena_node_t));
+    if (!n) return NULL;
+    if (arena_init(&n->arena, ARENA_DEFAULT_SIZE) < 0) {
+        free(n);
+        return NULL;
     }
+    return n;
+}
 
-    handler_entry_t *new_entry = &cache->entries[cache->size];
-    memset(new_entry, 0, sizeof(handler_entry_t));
+static void arena_node_put(worker_t *w, arena_node_t *n) {
+    arena_reset(&n->arena);
+    n->next = w->free_arenas;
+    w->free_arenas = n;
+}
 
-    if (load_handler(new_entry, full_path, &st, path_hash) == 0) {
-        cache->size++;
-        return new_entry;
+static void close_client(int client_fd) {
+    if (close(client_fd) < 0) {
+        if (errno == EBADF) {
+            LOG_DEBUG("Expected EBADF (FD already closed by child) on client FD %d.", client_fd);
+        } else {
+            LOG_WARN("Unexpected error closing client FD %d: %s", client_fd, strerror(errno));
+        }
+    } else {
+        LOG_DEBUG("Successfully closed client FD %d.", client_fd);
     }
+}
+
+/*
+ * Every cJSON node, key and print buffer in the worker comes from this
+ * arena. Trees are never cJSON_Delete()d: the arena is dropped wholesale
+ * once the event loop iteration that built them is done.
+ */
+static arena_t *g_json_arena;
 
-    return NULL;
+static void* json_malloc(size_t size) {
+    return arena_alloc(g_json_arena, size);
 }
 
-static void handle_request(int client_fd, handler_cache_t *cache, shm_layout_t* map, int i)
-{
-    struct timeval tv;
-    tv.tv_sec = 5; 
-    tv.tv_usec = 0;
-    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
-    
-    headers_t hdrs = {0};
-    
-    if (read_headers(client_fd, &hdrs) < 0) {
-        LOG_WARN("Failed to read headers");
+static void json_free(void *ptr) {
+    (void)ptr;
+}
+
+static void* ctx_alloc(caffeine_ctx_t *ctx, size_t size) {
+    request_t *req = ctx->priv;
+    return arena_alloc(&req->arena->arena, size);
+}
+
+static int ctx_json_parse(caffeine_ctx_t *ctx, const char *json, size_t len, caffeine_json_t *doc) {
+    request_t *req = ctx->priv;
+    return json_tape_build(&req->arena->arena, json, len, doc);
+}
+
+// an fd has one waiter at a time, epoll keeps a single registration per fd
+static int ctx_await(caffeine_ctx_t *ctx, int fd, unsigned int events, caffeine_cont_func cont) {
+    request_t *req = ctx->priv;
+    if (fd < 0 || !cont || !req) return -1;
+    for (request_t *p = req->w->pending; p; p = p->next) {
+        if (p != req && p->await_fd == fd) {
+            LOG_ERROR("fd %d already has a suspended request waiting on it", fd);
+            errno = EBUSY;
+            return -1;
+        }
+    }
+    req->await_fd = fd;
+    req->await_events = events;
+    req->cont = cont;
+    return 0;
+}
+
+/*
+ * Keeps the serialized response of a static handler so that later requests
+ * are answered with a single write() and never reach the handler.
+ */
+static void capture_static(request_t *req, const char *hdr, size_t hdr_len, const char *body, size_t body_len) {
+    handler_entry_t *entry = req->entry;
+    char *blob = malloc(hdr_len + body_len);
+    if (!blob) return;
+
+    memcpy(blob, hdr, hdr_len);
+    memcpy(blob + hdr_len, body, body_len);
+    free(entry->static_resp);
+    entry->static_resp = blob;
+    entry->static_len = hdr_len + body_len;
+    entry->static_expires_ms = entry->static_ttl_ms > 0 ? now_ms() + entry->static_ttl_ms : 0;
+}
+
+// one finished request in this worker's shm counters
+static void count_request(worker_t *w, int http_status, size_t bytes_in, size_t bytes_out, uint64_t start_us) {
+    shm_worker_stats_t *st = &w->map->stats[w->slot];
+    int cls = http_status / 100 - 1;
+
+    shm_counter_add(&st->requests, 1);
+    shm_counter_add(&st->bytes_in, bytes_in);
+    shm_counter_add(&st->bytes_out, bytes_out);
+    if (cls >= 0 && cls < 5) shm_counter_add(&st->status[cls], 1);
+    hist_record(&st->latency_us, now_us() - start_us);
+}
+
+// one finished call of entry in this worker slot's row for it
+static void count_call(worker_t *w, handler_entry_t *entry, int http_status, size_t bytes_out, uint64_t cpu_ns, uint64_t start_us) {
+    uint32_t idx = entry->shm_idx;
+    if (idx == HANDLER_IDX_NONE || (uint32_t)w->slot >= w->map->stats_slots) return;
+
+    shm_handler_stats_t *hs = shm_handler_stats(w->map, w->slot, idx);
+    uint64_t latency = now_us() - start_us;
+    shm_counter_add(&hs->calls, 1);
+    shm_counter_add(&hs->latency_us, latency);
+    shm_counter_add(&hs->cpu_ns, cpu_ns);
+    shm_counter_add(&hs->bytes_out, bytes_out);
+    hist_coarse_record(shm_handler_latency(w->map, w->slot, idx), latency);
+    if (http_status >= 500) shm_counter_add(&hs->errors, 1);
+}
+
+static int serve_static(worker_t *w, handler_entry_t *entry, int client_fd, size_t bytes_in, uint64_t start_us) {
+    if (!entry->is_static || !entry->static_resp) return 0;
+    if (entry->static_expires_ms && now_ms() >= entry->static_expires_ms) return 0;
+
+    ssize_t n = write_fully(client_fd, entry->static_resp, entry->static_len);
+    close_client(client_fd);
+    // the stored response starts with "HTTP/1.1 <status>"
+    int status = atoi(entry->static_resp + 9);
+    size_t bytes_out = n > 0 ? (size_t)n : 0;
+    count_request(w, status, bytes_in, bytes_out, start_us);
+    count_call(w, entry, status, bytes_out, 0, start_us);
+    return 1;
+}
+
+static const char* status_text(int http_status) {
+    switch (http_status) {
+        case 200: return "OK";
+        case 226: return "IM Used";
+        case 304: return "Not Modified";
+        default:  return "Error";
+    }
+}
+
+static int format_http_header(char *buf, size_t size, int http_status, const char *content_type, size_t body_len, const char *extra) {
+    int hdr_len = snprintf(buf, size,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Length: %zu\r\n"
+        "Content-Type: %s\r\n"
+        "%s"
+        "Connection: close\r\n\r\n",
+        http_status, status_text(http_status), 
+        body_len, content_type, extra ? extra : "");
+    if (hdr_len < 0 || (size_t)hdr_len >= size) return -1;
+    return hdr_len;
+}
+
+// one of the prebuilt responses in response.h
+static void send_canned(request_t *req, int http_status, const char *resp, size_t len) {
+    ssize_t n = write(req->client_fd, resp, len);
+    req->status = http_status;
+    if (n > 0) req->bytes_out += n;
+}
+
+static void send_http(request_t *req, int http_status, const char *content_type, const char *body, size_t body_len) {
+    char http_hdr[512];
+    req->status = http_status;
+    int hdr_len = format_http_header(http_hdr, sizeof(http_hdr), http_status, content_type, body_len, req->extra_headers);
+    if (hdr_len < 0) {
+        send_canned(req, 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
         return;
     }
 
-    cJSON *req_json = cJSON_CreateObject();
-    cJSON_AddStringToObject(req_json, "handler", hdrs.handler_name);
-    
-    cJSON *req_headers = cJSON_CreateObject();
-    cJSON_AddStringToObject(req_headers, "headers", hdrs.headers);
-    
-    char *json_request_str = cJSON_PrintUnformatted(req_headers);
-    unsigned long path_hash = hash_path(hdrs.handler_name);
-    handler_entry_t *entry = get_handler_from_cache(cache, hdrs.handler_name, path_hash);
-    
-    if (!entry) {
-        write(client_fd, NOT_FOUND, NOT_FOUND_LEN);
-        cJSON_Delete(req_json);
-        free(json_request_str);
+    struct iovec iov[2] = {
+        { .iov_base = http_hdr, .iov_len = hdr_len },
+        { .iov_base = (char *)body, .iov_len = body_len }
+    };
+    ssize_t n = writev_fully(req->client_fd, iov, 2);
+    if (n > 0) req->bytes_out += n;
+    if (req->capture) capture_static(req, http_hdr, hdr_len, body, body_len);
+}
+
+/*
+ * Prints the merge patch send_delta() built straight into the worker output
+ * buffer, past a gap reserved for the header. The header is formatted once
+ * Content-Length is known and copied into the tail of the gap, so the
+ * response goes out as one contiguous write(). The buffer is shrunk back on
+ * every way out, a large patch must not keep it grown.
+ */
+static void send_json(request_t *req, int http_status, const char *content_type, cJSON *body) {
+    guard_buf_t *out = &req->w->out;
+    char *body_start = out->base + OUT_HDR_GAP;
+    int body_len;
+
+    while ((body_len = cJSON_PrintPreallocatedLength(body, body_start, (int)(out->cap - OUT_HDR_GAP), 0)) < 0) {
+        if (out->cap >= out->max_cap || guard_buf_grow(out, out->cap * 2) < 0) {
+            LOG_WARN("JSON body does not fit in %zu bytes", out->max_cap);
+            break;
+        }
+    }
+
+    char http_hdr[OUT_HDR_GAP];
+    int hdr_len = body_len < 0 ? -1
+        : format_http_header(http_hdr, sizeof(http_hdr), http_status, content_type, body_len, req->extra_headers);
+    if (hdr_len < 0) {
+        send_canned(req, 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
+    } else {
+        char *resp = body_start - hdr_len;
+        memcpy(resp, http_hdr, hdr_len);
+        req->status = http_status;
+
+        ssize_t n = write_fully(req->client_fd, resp, hdr_len + body_len);
+        if (n > 0) req->bytes_out += n;
+        if (req->capture) capture_static(req, resp, hdr_len, body_start, body_len);
+    }
+    guard_buf_shrink(out);
+}
+
+// a merge patch reads null as "remove the member", so it cannot carry one
+static int json_has_null(const cJSON *item) {
+    for (; item; item = item->next) {
+        if (cJSON_IsNull(item) || json_has_null(item->child)) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Answers a handler exporting delta_versions_val. A client repeating the
+ * ETag of the current body gets a 304; one that also sends
+ * "A-IM: merge-patch" for a version this worker still holds gets an
+ * RFC 7386 merge patch against it (RFC 3229 226 IM Used), unless the new
+ * body holds a null, which only the full body can express.
+ */
+static void send_delta(request_t *req, delta_history_t *hist, const envelope_t *env) {
+    uint64_t etag = delta_hash(env->body, env->body_len);
+    char *extra = arena_alloc(&req->arena->arena, 64);
+    if (!extra) {
+        send_canned(req, 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
+        return;
+    }
+
+    if (req->client_etag == etag) {
+        snprintf(extra, 64, "ETag: \"%016llx\"\r\n", (unsigned long long)etag);
+        req->extra_headers = extra;
+        send_http(req, 304, "application/json", "", 0);
+        return;
+    }
+
+    cJSON *patch = NULL;
+    const delta_version_t *held = req->wants_patch ? delta_find(hist, req->delta_key, req->client_etag) : NULL;
+    if (held) {
+        cJSON *from = cJSON_ParseWithLength(held->json, held->len);
+        cJSON *to = cJSON_ParseWithLength(env->body, env->body_len);
+        if (from && to && !json_has_null(to)) {
+            patch = cJSONUtils_GenerateMergePatchCaseSensitive(from, to);
+            // same document, only the formatting changed
+            if (!patch) patch = cJSON_CreateObject();
+        }
+    }
+    delta_record(hist, req->delta_key, etag, env->body, env->body_len);
+
+    if (patch) {
+        snprintf(extra, 64, "ETag: \"%016llx\"\r\nIM: merge-patch\r\n", (unsigned long long)etag);
+        req->extra_headers = extra;
+        send_json(req, 226, "application/merge-patch+json", patch);
+    } else {
+        snprintf(extra, 64, "ETag: \"%016llx\"\r\n", (unsigned long long)etag);
+        req->extra_headers = extra;
+        send_http(req, env->status, "application/json", env->body, env->body_len);
+    }
+}
+
+static void write_response(request_t *req, const char *final_json_ptr, size_t json_len) {
+    // raw mode: the handler output already is the body
+    if (req->ctx.raw_status) {
+        const char *ctype = req->ctx.raw_content_type ? req->ctx.raw_content_type : "application/octet-stream";
+        send_http(req, req->ctx.raw_status, ctype, final_json_ptr, json_len);
         return;
     }
-    char response_buffer[65536];
+
+    envelope_t env;
+    int rc = envelope_scan(final_json_ptr, json_len, &env);
+    if (rc == ENVELOPE_SLOW_PATH) rc = envelope_decode(&req->arena->arena, final_json_ptr, json_len, &env);
+    if (rc < 0) {
+        send_canned(req, 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
+        return;
+    }
+
+    handler_entry_t *entry = req->entry;
+    if (entry->delta && env.status == 200 && !env.body_is_string && env.body_len && env.body[0] == '{')
+        send_delta(req, entry->delta, &env);
+    else
+        send_http(req, env.status, "application/json", env.body, env.body_len);
+}
+
+static void unlink_pending(worker_t *w, request_t *req) {
+    if (req->prev) req->prev->next = req->next;
+    else w->pending = req->next;
+    if (req->next) req->next->prev = req->prev;
+    req->prev = req->next = NULL;
+    w->pending_count--;
+}
+
+static void release_request(worker_t *w, request_t *req) {
+    close_client(req->client_fd);
+    count_request(w, req->status, req->bytes_in, req->bytes_out, req->start_us);
+
+    count_call(w, req->entry, req->status, req->bytes_out, req->cpu_ns, req->start_us);
+    handler_put(&w->cache, req->entry);
+    if (req->prev || w->pending == req) {
+        unlink_pending(w, req);
+        if (--req->arena->parked == 0 && req->arena != w->arena)
+            arena_node_put(w, req->arena);
+    }
+}
+
+/*
+ * Parks a request that returned CAFFEINE_PENDING. The request keeps its
+ * arena alive (shared with anything else parked from the same accept round)
+ * and the worker continues with a fresh one from the pool.
+ */
+static int park_request(worker_t *w, request_t *req) {
+    struct epoll_event ev = { .events = req->await_events | EPOLLONESHOT, .data.ptr = req };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, req->await_fd, &ev) < 0) {
+        LOG_ERROR("Failed to watch fd %d for pending request: %s", req->await_fd, strerror(errno));
+        return -1;
+    }
+
+    if (req->arena == w->arena) {
+        arena_node_t *fresh = arena_node_get(w);
+        if (!fresh) {
+            epoll_ctl(w->epfd, EPOLL_CTL_DEL, req->await_fd, NULL);
+            return -1;
+        }
+        w->arena = fresh;
+    }
+
+    if (!req->prev && w->pending != req) {
+        req->next = w->pending;
+        if (w->pending) w->pending->prev = req;
+        w->pending = req;
+        w->pending_count++;
+        req->arena->parked++;
+    }
+    return 0;
+}
+
+/*
+ * Publishes which handler this worker is running before flipping to busy,
+ * so the supervisor holds it to that handler's timeout.
+ */
+static void mark_busy(worker_t *w, handler_entry_t *entry) {
+    shm_worker_publish(&w->map->workers[w->slot], W_BUSY, entry->shm_idx, entry->loaded_version, now_ms());
+}
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*
+ * Runs the handler entry point, or the registered continuation when entry
+ * is NULL, and either parks the request or completes it.
+ */
+static void run_handler(worker_t *w, request_t *req, handler_entry_t *entry) {
+    caffeine_cont_func cont = req->cont;
     size_t result_len = 0;
-    
-    map->workers[i].state = W_BUSY;
-    map->workers[i].start_ms = now_ms();
-    const char *result_ptr = entry->func(
-        json_request_str,
-        response_buffer,
-        sizeof(response_buffer),
-        &result_len
-    );
-    const char *final_json_ptr = (result_ptr != NULL) ? result_ptr : response_buffer;
-    cJSON *res_json = cJSON_Parse(final_json_ptr);
-    
-    if (res_json) {
-        cJSON *status = cJSON_GetObjectItem(res_json, "status");
-        cJSON *body = cJSON_GetObjectItem(res_json, "body");
-        
-        int http_status = status ? status->valueint : 200;
-        char *body_str = cJSON_IsObject(body) ? cJSON_PrintUnformatted(body) : strdup(body->valuestring);
-        
-        char http_resp[70000];
-        int full_len = snprintf(http_resp, sizeof(http_resp),
-            "HTTP/1.1 %d %s\r\n"
-            "Content-Length: %zu\r\n"
-            "Content-Type: application/json\r\n"
-            "Connection: close\r\n\r\n"
-            "%s",
-            http_status, (http_status == 200 ? "OK" : "Error"), 
-            strlen(body_str), body_str);
-
-        write(client_fd, http_resp, full_len);
-        free(body_str);
-        cJSON_Delete(res_json);
+    const char *result_ptr;
+    int grew = 0;
+    int raw_status = req->ctx.raw_status;
+    const char *raw_content_type = req->ctx.raw_content_type;
+
+    mark_busy(w, entry ? entry : req->entry);
+    uint64_t cpu_start = thread_cpu_ns();
+    for (int attempt = 0; ; attempt++) {
+        req->await_fd = -1;
+        req->cont = NULL;
+        req->ctx.raw_status = raw_status;
+        req->ctx.raw_content_type = raw_content_type;
+        result_len = 0;
+
+        if (!entry) {
+            result_ptr = cont(&req->ctx, w->resp.base, w->resp.cap, &result_len);
+        } else if (entry->script) {
+            result_ptr = script_call(&req->ctx, entry->script, w->resp.base, w->resp.cap, &result_len);
+        } else if (entry->ctx_func) {
+            result_ptr = entry->ctx_func(&req->ctx, w->resp.base, w->resp.cap, &result_len);
+        } else {
+            result_ptr = entry->func(req->ctx.request, w->resp.base, w->resp.cap, &result_len);
+        }
+
+        // NULL with a length larger than the buffer asks for a bigger one
+        if (result_ptr || result_len <= w->resp.cap || attempt == MAX_GROW_ATTEMPTS) break;
+        if (guard_buf_grow(&w->resp, result_len + 1) < 0) {
+            LOG_WARN("Handler asked for a %zu byte response buffer, limit is %zu", result_len, w->resp.max_cap);
+            break;
+        }
+        grew = 1;
+    }
+    req->cpu_ns += thread_cpu_ns() - cpu_start;
+    shm_worker_set_state(&w->map->workers[w->slot], W_IDLE);
+
+    if (result_ptr == CAFFEINE_PENDING) {
+        if (req->await_fd >= 0 && park_request(w, req) == 0) return;
+        LOG_ERROR("Handler returned pending without a usable await registration");
+        send_canned(req, 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
+    } else if (result_ptr) {
+        size_t len = (req->ctx.raw_status && result_len) ? result_len : strlen(result_ptr);
+        write_response(req, result_ptr, len);
+    } else if (result_len > w->resp.cap) {
+        send_canned(req, 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
     } else {
-        write(client_fd, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
+        size_t len = req->ctx.raw_status ? result_len : strnlen(w->resp.base, w->resp.cap);
+        write_response(req, w->resp.base, len);
+    }
+
+    // a large response is rare, give the pages back once a request fits again
+    if (!grew) guard_buf_shrink(&w->resp);
+    release_request(w, req);
+}
+
+/*
+ * Hands every request for one handler to its handler_batch() export, so the
+ * handler lookup, shm state updates and the call itself are paid once.
+ */
+static void run_batch(worker_t *w, request_t **reqs, size_t n, handler_entry_t *entry) {
+    caffeine_ctx_t *ctxs[MAX_BATCH];
+    caffeine_slice_t resps[MAX_BATCH];
+
+    for (size_t k = 0; k < n; k++) {
+        ctxs[k] = &reqs[k]->ctx;
+        resps[k].data = NULL;
+        resps[k].len = 0;
+    }
+
+    mark_busy(w, entry);
+    uint64_t cpu_start = thread_cpu_ns();
+    entry->batch_func(ctxs, n, resps);
+    // split evenly, the handler does not say what each request cost
+    uint64_t cpu = thread_cpu_ns() - cpu_start;
+    for (size_t k = 0; k < n; k++) reqs[k]->cpu_ns = cpu / n;
+    shm_worker_set_state(&w->map->workers[w->slot], W_IDLE);
+
+    for (size_t k = 0; k < n; k++) {
+        if (resps[k].data) {
+            write_response(reqs[k], resps[k].data, resps[k].len);
+        } else {
+            send_canned(reqs[k], 500, INTERNAL_ERROR, INTERNAL_ERROR_LEN);
+        }
+        release_request(w, reqs[k]);
+    }
+}
+
+static void resume_request(worker_t *w, request_t *req, uint32_t events) {
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, req->await_fd, NULL);
+    req->ctx.ready_events = events;
+    run_handler(w, req, NULL);
+}
+
+static int expire_requests(worker_t *w) {
+    uint64_t now = now_ms();
+    int next = -1;
+
+    request_t *req = w->pending;
+    while (req) {
+        request_t *next_req = req->next;
+        if (req->deadline_ms <= now) {
+            LOG_WARN("Pending request on FD %d timed out", req->client_fd);
+            epoll_ctl(w->epfd, EPOLL_CTL_DEL, req->await_fd, NULL);
+            size_t result_len = 0;
+            req->ctx.ready_events = 0;
+            req->cont(&req->ctx, w->resp.base, w->resp.cap, &result_len);
+            send_canned(req, 408, REQUEST_TIMEOUT, REQUEST_TIMEOUT_LEN);
+            shm_counter_add(&w->map->stats[w->slot].timeouts, 1);
+            release_request(w, req);
+        } else {
+            int left = (int)(req->deadline_ms - now);
+            if (next < 0 || left < next) next = left;
+        }
+        req = next_req;
+    }
+    return next;
+}
+
+// first entity tag of an If-None-Match value, 0 when it is not one of ours
+static uint64_t parse_etag(const char *v, size_t len) {
+    char tag[17];
+    if (len >= 2 && v[0] == 'W' && v[1] == '/') {
+        v += 2;
+        len -= 2;
+    }
+    if (len < 18 || v[0] != '"' || v[17] != '"') return 0;
+
+    memcpy(tag, v + 1, 16);
+    tag[16] = 0;
+    char *end;
+    uint64_t etag = strtoull(tag, &end, 16);
+    return *end ? 0 : etag;
+}
+
+// turns a client whose headers are complete into a request, NULL once it has been answered
+static request_t* prepare_request(worker_t *w, int client_fd, headers_t *hdrs, uint64_t start_us)
+{
+    arena_t *arena = &w->arena->arena;
+
+    handler_entry_t *entry = route_handler(w->map, &w->cache, hdrs->handler_name, &w->rng);
+    if (entry && serve_static(w, entry, client_fd, hdrs->bytes_read, start_us)) return NULL;
+
+    char *envelope = arena_alloc(arena, envelope_request_max(hdrs));
+    size_t envelope_len = envelope ? envelope_write_request(envelope, hdrs) : 0;
+    if (envelope) arena_trim(arena, envelope, envelope_len + 1);
+    request_t *req = arena_alloc(arena, sizeof(request_t));
+    
+    if (!entry || !envelope || !req) {
+        ssize_t n = write(client_fd, entry ? INTERNAL_ERROR : NOT_FOUND, entry ? INTERNAL_ERROR_LEN : NOT_FOUND_LEN);
+        close_client(client_fd);
+        count_request(w, entry ? 500 : 404, hdrs->bytes_read, n > 0 ? (size_t)n : 0, start_us);
+        return NULL;
+    }
+
+    memset(req, 0, sizeof(request_t));
+    req->kind = EV_REQUEST;
+    req->w = w;
+    req->arena = w->arena;
+    req->entry = entry;
+    entry->refs++;
+    req->start_us = start_us;
+    req->status = 500;
+    req->bytes_in = hdrs->bytes_read;
+    req->capture = entry->is_static;
+    req->client_fd = client_fd;
+    req->await_fd = -1;
+    req->deadline_ms = now_ms() + entry->timeout_ms;
+    req->ctx.request = envelope;
+    req->ctx.request_len = envelope_len;
+    req->ctx.alloc = ctx_alloc;
+    req->ctx.await = ctx_await;
+    req->ctx.json_parse = ctx_json_parse;
+    req->ctx.priv = req;
+    if (entry->raw_content_type) {
+        req->ctx.raw_status = 200;
+        req->ctx.raw_content_type = entry->raw_content_type;
+    }
+    if (entry->delta) {
+        size_t vlen;
+        req->delta_key = delta_hash(hdrs->path, strnlen(hdrs->path, sizeof(hdrs->path)));
+        const char *v = find_header(hdrs->headers, "If-None-Match", &vlen);
+        if (v) req->client_etag = parse_etag(v, vlen);
+        v = find_header(hdrs->headers, "A-IM", &vlen);
+        req->wants_patch = v && memmem(v, vlen, "merge-patch", 11) != NULL;
+    }
+
+    return req;
+}
+
+static void dispatch_requests(worker_t *w, request_t **reqs, size_t n)
+{
+    request_t *group[MAX_BATCH];
+
+    for (size_t k = 0; k < n; k++) {
+        if (!reqs[k]) continue;
+
+        handler_entry_t *entry = reqs[k]->entry;
+        if (!entry->batch_func) {
+            run_handler(w, reqs[k], entry);
+            continue;
+        }
+
+        size_t m = 0;
+        for (size_t j = k; j < n; j++) {
+            if (reqs[j] && reqs[j]->entry == reqs[k]->entry) {
+                group[m++] = reqs[j];
+                if (j != k) reqs[j] = NULL;
+            }
+        }
+        if (m == 1 && (entry->ctx_func || entry->func)) {
+            run_handler(w, reqs[k], entry);
+        } else {
+            run_batch(w, group, m, entry);
+        }
+    }
+}
+
+static void reject_client(worker_t *w, int client_fd) {
+    LOG_WARN("Failed to read headers");
+    shm_counter_add(&w->map->stats[w->slot].parse_errors, 1);
+    close_client(client_fd);
+}
+
+static void unlink_client(worker_t *w, client_t *c) {
+    if (c->prev) c->prev->next = c->next;
+    else w->reading = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->next = w->free_clients;
+    w->free_clients = c;
+}
+
+// hdrs holds the part read so far, its headers_end is still NULL so it can be copied
+static void wait_for_headers(worker_t *w, int client_fd, const headers_t *hdrs, uint64_t start_us) {
+    client_t *c = w->free_clients;
+    if (c) w->free_clients = c->next;
+    else c = malloc(sizeof(client_t));
+    if (!c) {
+        reject_client(w, client_fd);
+        return;
     }
 
-    cJSON_Delete(req_json);
-    free(json_request_str);
+    c->kind = EV_CLIENT;
+    c->client_fd = client_fd;
+    c->start_us = start_us;
+    c->deadline_ms = start_us / 1000 + HEADER_TIMEOUT_MS;
+    memcpy(&c->hdrs, hdrs, sizeof(headers_t));
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+        LOG_ERROR("Failed to watch client FD %d: %s", client_fd, strerror(errno));
+        c->next = w->free_clients;
+        w->free_clients = c;
+        reject_client(w, client_fd);
+        return;
+    }
+    c->prev = NULL;
+    c->next = w->reading;
+    if (w->reading) w->reading->prev = c;
+    w->reading = c;
+}
+
+/*
+ * Dispatches the requests accept_clients() and continue_client() made ready
+ * during one pass over the epoll events, so that a client that finished its
+ * headers late is still batched with the others for its handler.
+ */
+static void dispatch_ready(worker_t *w) {
+    dispatch_requests(w, w->ready, w->ready_count);
+    w->ready_count = 0;
+    arena_reset(&w->arena->arena);
+}
+
+// more of a waiting client's headers arrived
+static void continue_client(worker_t *w, client_t *c) {
+    int rc = read_headers(c->client_fd, &c->hdrs);
+    if (rc == 0) return;
+
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->client_fd, NULL);
+    unlink_client(w, c);
+    if (rc < 0) {
+        reject_client(w, c->client_fd);
+        return;
+    }
+
+    // c stays intact until the next wait_for_headers(), nothing below adds one
+    if (w->ready_count == MAX_BATCH) dispatch_ready(w);
+    request_t *req = prepare_request(w, c->client_fd, &c->hdrs, c->start_us);
+    if (req) w->ready[w->ready_count++] = req;
+}
+
+static int expire_clients(worker_t *w) {
+    uint64_t now = now_ms();
+    int next = -1;
+
+    client_t *c = w->reading;
+    while (c) {
+        client_t *next_c = c->next;
+        if (c->deadline_ms <= now) {
+            LOG_WARN("Client timeout while reading headers on FD %d.", c->client_fd);
+            epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->client_fd, NULL);
+            unlink_client(w, c);
+            reject_client(w, c->client_fd);
+        } else {
+            int left = (int)(c->deadline_ms - now);
+            if (next < 0 || left < next) next = left;
+        }
+        c = next_c;
+    }
+    return next;
+}
+
+/*
+ * Drains the accept queue so that concurrent requests for the same handler
+ * can be dispatched together by dispatch_ready(). A client whose headers
+ * are not all there yet waits in epoll for the rest, see client_t.
+ */
+static void accept_clients(worker_t *w)
+{
+    while (w->ready_count < MAX_BATCH) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        char client_ip[INET_ADDRSTRLEN];
+
+        int client_fd = accept(w->listen_fd, (struct sockaddr *)&client_addr, &client_len);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG_ERROR("accept failed: %s", strerror(errno));
+            break;
+        }
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
+        LOG_DEBUG("Worker (PID %d) accepted connection from %s:%d on new FD %d.",
+            getpid(), client_ip, ntohs(client_addr.sin_port), client_fd);
+
+        headers_t hdrs = {0};
+        uint64_t start_us = now_us();
+        int rc = read_headers(client_fd, &hdrs);
+        if (rc < 0) {
+            reject_client(w, client_fd);
+        } else if (rc == 0) {
+            wait_for_headers(w, client_fd, &hdrs, start_us);
+        } else {
+            request_t *req = prepare_request(w, client_fd, &hdrs, start_us);
+            if (req) w->ready[w->ready_count++] = req;
+        }
+    }
+}
+
+/*
+ * Runs before the listen fd is added: loads the --warmup handlers, which
+ * also runs their handler_warmup(), and faults in the request buffers, so
+ * the first requests this worker takes do not pay for any of it. The
+ * supervisor leaves a W_WARMUP worker out of its load figures.
+ */
+static void warmup_worker(worker_t *w) {
+    uint64_t start = now_ms();
+    int loaded = 0;
+
+    guard_buf_prefault(&w->resp);
+    guard_buf_prefault(&w->out);
+    arena_prefault(&w->arena->arena);
+    arena_prefault(&w->json_arena);
+
+    if (g_cfg.warmup && !strcmp(g_cfg.warmup, "*")) {
+        uint32_t count = w->map->handler_count;
+        for (uint32_t k = 0; k < count; k++) {
+            shm_handler_t *reg = &w->map->handlers[k];
+            if (atomic_load_explicit(&reg->present, memory_order_relaxed) &&
+                get_handler_from_cache(w->map, &w->cache, reg->name)) loaded++;
+        }
+    } else if (g_cfg.warmup) {
+        char names[1024];
+        char *save = NULL;
+        snprintf(names, sizeof(names), "%s", g_cfg.warmup);
+        for (char *name = strtok_r(names, ", ", &save); name; name = strtok_r(NULL, ", ", &save)) {
+            if (get_handler_from_cache(w->map, &w->cache, name)) loaded++;
+            else LOG_WARN("Warmup handler %s not found", name);
+        }
+    }
+    LOG_INFO("Worker %d warmed up %d handlers in %llu ms", getpid(), loaded, (unsigned long long)(now_ms() - start));
+    if (g_cfg.hugepages) {
+        report_hugepages();
+        LOG_INFO("Worker %d huge pages: %u kB anonymous, %u kB file backed", getpid(),
+                 (unsigned)atomic_load(&g_self->anon_huge_kb), (unsigned)atomic_load(&g_self->file_huge_kb));
+    }
 }
 
 void exec_worker(int listen_fd, shm_layout_t* map, int i)
@@ -191,9 +1167,34 @@ void exec_worker(int listen_fd, shm_layout_t* map, int i)
     if (g_cfg.daemonize)
         worker_redirect_logs();
 
-    handler_cache_t cache = {0};
+    static worker_t w;
+    w.map = map;
+    w.slot = i;
+    w.cache.reload_delay_ms = (uint32_t)i * HANDLER_RELOAD_STAGGER_MS;
+    w.rng = ((uint64_t)getpid() << 32) ^ now_us() ^ 0x9e3779b97f4a7c15ull;
+    w.listen_fd = listen_fd;
+    g_self = &map->workers[i];
+    arena_set_hugepages(g_cfg.hugepages);
+    w.arena = arena_node_get(&w);
+    if (!w.arena || guard_buf_init(&w.resp, GUARD_BUF_DEFAULT_SIZE, GUARD_BUF_MAX_SIZE) < 0 ||
+        guard_buf_init(&w.out, GUARD_BUF_DEFAULT_SIZE, GUARD_BUF_MAX_SIZE) < 0 ||
+        arena_init(&w.json_arena, ARENA_DEFAULT_SIZE) < 0) {
+        LOG_ERROR("Worker %d failed to allocate its request buffers", getpid());
+        _exit(1);
+    }
+
+    if (g_cfg.hugepages) {
+        // only takes effect on the parts a grown buffer spans
+        hugepage_advise(w.resp.base, w.resp.max_cap);
+        hugepage_advise(w.out.base, w.out.max_cap);
+    }
+
+    g_json_arena = &w.json_arena;
+    cJSON_Hooks hooks = { .malloc_fn = json_malloc, .free_fn = json_free };
+    cJSON_InitHooks(&hooks);
 
     LOG_INFO("Worker %d started", getpid());
+    warmup_worker(&w);
 
     int hb_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
     if (hb_tfd < 0) {
@@ -201,38 +1202,52 @@ void exec_worker(int listen_fd, shm_layout_t* map, int i)
         _exit(1);
     }
 
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    char client_ip[INET_ADDRSTRLEN];
-    int client_fd;
-    // shm_layout_t layout;
-    // memcpy(&layout, map, sizeof(shm_layout_t));
-    for (;;) {
-        map->workers[i].state = W_IDLE;
+    // The listening socket is shared by every worker, accept() must not
+    // block once another worker has taken the connection.
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
 
-        client_fd = accept(listen_fd, (struct sockaddr *)&client_addr, &client_len);
+    w.epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event lev = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL };
+    if (w.epfd < 0 || epoll_ctl(w.epfd, EPOLL_CTL_ADD, listen_fd, &lev) < 0) {
+        LOG_ERROR("epoll setup failed: %s", strerror(errno));
+        _exit(1);
+    }
 
-        if (client_fd < 0) {
-            LOG_ERROR("accept failed: %s", strerror(errno));
-            continue;
+    struct epoll_event events[MAX_EVENTS];
+    int timeout = -1;
+    for (;;) {
+        shm_worker_set_state(&map->workers[i], W_IDLE);
+
+        int n = epoll_wait(w.epfd, events, MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: %s", strerror(errno));
+            break;
         }
-        LOG_DEBUG("Worker (PID %d) accepted connection from %s:%d on new FD %d.",
-            getpid(), client_ip, ntohs(client_addr.sin_port), client_fd);
-        
-        handle_request(client_fd, &cache, map, i);
 
-        if (close(client_fd) < 0) {
-            if (errno == EBADF) {
-                LOG_DEBUG("Expected EBADF (FD already closed by child) on client FD %d.", client_fd);
+        for (int e = 0; e < n; e++) {
+            ev_kind_t *kind = events[e].data.ptr;
+            if (kind == NULL) {
+                accept_clients(&w);
+            } else if (*kind == EV_CLIENT) {
+                continue_client(&w, (client_t *)kind);
             } else {
-                LOG_WARN("Unexpected error closing client FD %d: %s", client_fd, strerror(errno));
+                resume_request(&w, (request_t *)kind, events[e].events);
             }
-        } else {
-            LOG_DEBUG("Successfully closed client FD %d.", client_fd);
         }
+        dispatch_ready(&w);
+
+        timeout = w.pending_count ? expire_requests(&w) : -1;
+        if (w.reading) {
+            int left = expire_clients(&w);
+            if (timeout < 0 || (left >= 0 && left < timeout)) timeout = left;
+        }
+        arena_reset(&w.json_arena);
     }
 
     close(hb_tfd);
+    close(w.epfd);
+    guard_buf_destroy(&w.resp);
+    guard_buf_destroy(&w.out);
     _exit(0);
 }
-
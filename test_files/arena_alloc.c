@@ -0,0 +1,31 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <caffeine_handler.h>
+
+const char* handler_ctx(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    // Scratch memory comes from the worker's per-request arena and is
+    // released after the response is written: no free() needed.
+    size_t cap = ctx->request_len + 64;
+    char *out = caffeine_alloc(ctx, cap);
+    if (!out) return NULL;
+
+    int written = snprintf(out, cap, "{\"status\": 200, \"body\": \"request envelope is %zu bytes\"}", ctx->request_len);
+    if (written < 0 || (size_t)written >= cap) return NULL;
+
+    *result_len = written;
+    return out;
+}
+
+#ifdef __cplusplus
+}
+#endif
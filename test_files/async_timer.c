@@ -0,0 +1,55 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <caffeine_handler.h>
+
+static const char* on_timer(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    int fd = (int)(intptr_t)ctx->user;
+    uint64_t expirations;
+
+    read(fd, &expirations, sizeof(expirations));
+    close(fd);
+    if (ctx->ready_events == 0) return NULL;
+
+    int written = snprintf(response_buffer, buffer_size, "{\"status\": 200, \"body\": \"Resumed after 100ms without blocking the worker\"}");
+    *result_len = written;
+    return response_buffer;
+}
+
+const char* handler_ctx(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    // Stands in for a request to a cache daemon or another service: any
+    // non-blocking fd works the same way.
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct itimerspec its = { .it_value = { .tv_sec = 0, .tv_nsec = 100 * 1000000 } };
+    timerfd_settime(fd, 0, &its, NULL);
+
+    ctx->user = (void *)(intptr_t)fd;
+    if (caffeine_await(ctx, fd, POLLIN, on_timer) < 0) {
+        close(fd);
+        return NULL;
+    }
+    return CAFFEINE_PENDING;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <poll.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <caffeine_handler.h>
+
+// Waits on a timer that fires long after the handler timeout: the worker
+// calls on_timer() once with ready_events == 0 and answers 408.
+int timeout_val = 300;
+
+static const char* on_timer(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    close((int)(intptr_t)ctx->user);
+    if (ctx->ready_events == 0) return NULL;
+
+    int written = snprintf(response_buffer, buffer_size, "{\"status\": 200, \"body\": \"The timer fired before the timeout\"}");
+    *result_len = written;
+    return response_buffer;
+}
+
+const char* handler_ctx(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct itimerspec its = { .it_value = { .tv_sec = 2 } };
+    timerfd_settime(fd, 0, &its, NULL);
+    ctx->user = (void *)(intptr_t)fd;
+    if (caffeine_await(ctx, fd, POLLIN, on_timer) < 0) {
+        close(fd);
+        return NULL;
+    }
+    return CAFFEINE_PENDING;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,25 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+// Returns an envelope cut off halfway: the worker must answer 500 instead
+// of sending whatever it managed to parse.
+const char* handler(
+    const char *request_data,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    const char* BROKEN_JSON = "{\"status\": 200, \"body\": \"never clos";
+
+    *result_len = strlen(BROKEN_JSON);
+    return BROKEN_JSON;
+}
+
+#ifdef __cplusplus
+}
+#endif
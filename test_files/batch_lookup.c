@@ -0,0 +1,36 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <caffeine_handler.h>
+
+static const char* HELLO = "{\"status\": 200, \"body\": \"Hello from a single call\"}";
+
+const char* handler(
+    const char *request_data,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    *result_len = strlen(HELLO);
+    return HELLO;
+}
+
+void handler_batch(caffeine_ctx_t **reqs, size_t n, caffeine_slice_t *resps) {
+    // A real handler would issue one batched lookup for all n keys here.
+    for (size_t i = 0; i < n; i++) {
+        char *out = caffeine_alloc(reqs[i], 96);
+        if (!out) continue;
+
+        int written = snprintf(out, 96, "{\"status\": 200, \"body\": \"Request %zu of a batch of %zu\"}", i + 1, n);
+        resps[i].data = out;
+        resps[i].len = written;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <time.h>
+#include <caffeine_handler.h>
+
+// Keep the last 4 bodies per path so polling clients can ask for a merge patch.
+int delta_versions_val = 4;
+
+const char* handler(
+    const char *request,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    // /delta_dashboard?nulls adds a member a merge patch could only read as "remove it"
+    const char *maintenance = strstr(request, "?nulls") ? "\"maintenance\": null, " : "";
+    int written = snprintf(response_buffer, buffer_size,
+        "{\"status\": 200, \"body\": {"
+        "\"service\": \"caffeine\", "
+        "\"regions\": [\"eu-west\", \"us-east\", \"ap-south\"], "
+        "\"limits\": {\"workers\": 64, \"handlers\": 128}, "
+        "%s\"uptime_s\": %ld}}",
+        maintenance, (long)(time(NULL) % 100000));
+
+    if (written < 0 || (size_t)written >= buffer_size) {
+        *result_len = written < 0 ? 0 : (size_t)written + 1;
+        return NULL;
+    }
+    *result_len = (size_t)written;
+    return response_buffer;
+}
+
+#ifdef __cplusplus
+}
+#endif
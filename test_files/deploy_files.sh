@@ -1,6 +1,6 @@
 #!/bin/bash
 
-HANDLER_FILES=("static_response.c" "dynamic_buffer.c" "dynamic_no_length.c")
+HANDLER_FILES=("static_response.c" "dynamic_buffer.c" "dynamic_no_length.c" "arena_alloc.c" "async_timer.c" "batch_lookup.c" "raw_html.c" "delta_dashboard.c" "json_request.c" "json_strings.c")
 SO_FILES=()
 SUCCESS_COUNT=0
 FAILURE_COUNT=0
@@ -11,7 +11,7 @@ compile_handler() {
     
     echo "Compiling $C_FILE -> $SO_FILE..."
     
-    if gcc -shared -fPIC "$C_FILE" -o "$SO_FILE"; then
+    if gcc -shared -fPIC -I../include "$C_FILE" -o "$SO_FILE"; then
         echo "Compilation successful."
         SO_FILES+=("$SO_FILE")
         return 0
@@ -11,11 +11,11 @@ extern "C" {
 
 const char* handler(
     const char *request_data, 
-    size_t data_len, 
     char *response_buffer, 
     size_t buffer_size,
     size_t *result_len
 ) {
+    size_t data_len = strlen(request_data);
     time_t timer;
     char time_buffer[26];
     struct tm* tm_info;
@@ -32,11 +32,15 @@ const char* handler(
         data_len
     );
 
-    // Ensure we didn't overflow the buffer
-    if (written < 0 || (size_t)written >= buffer_size) {
-        // Handle overflow error by writing a static error or crashing gracefully
+    if (written < 0) {
         *result_len = 0;
-        return NULL; // Or return a static error string
+        return NULL;
+    }
+
+    // Too small: report the size we need, the worker calls us again with it
+    if ((size_t)written >= buffer_size) {
+        *result_len = written + 1;
+        return NULL;
     }
 
     // 1. Set the length (CRUCIAL for this path)
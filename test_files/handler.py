@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# Script handler: each worker keeps this running and writes one request per
+# frame, "<length>\n<request JSON>" (or "@<length>\n" with the JSON on fd 3
+# when it is large). Every reply is "<length>[ <status>]\n<body>", a body
+# over 60 KiB goes back through fd 3 as "@<length>\n".
+
+import json
+import os
+import sys
+
+INLINE_MAX = 60 * 1024
+
+
+def handle(req):
+    path = req.get("path", "")
+    head, _, body = req.get("headers", "").partition("\r\n\r\n")
+    return 200, {
+        "status": "success",
+        "method_used": req.get("method", ""),
+        "query": path.partition("?")[2],
+        "message": "Hello from Python!",
+        "body_received": body,
+    }
+
+
+def main():
+    inp, out = sys.stdin.buffer, sys.stdout.buffer
+    for frame in inp:
+        frame = frame.strip()
+        if frame.startswith(b"@"):
+            raw = os.pread(3, int(frame[1:]), 0)
+        else:
+            raw = inp.read(int(frame))
+
+        status, resp = handle(json.loads(raw))
+        body = json.dumps(resp).encode()
+        if len(body) > INLINE_MAX:
+            os.pwrite(3, body, 0)
+            out.write(b"@%d %d\n" % (len(body), status))
+        else:
+            out.write(b"%d %d\n" % (len(body), status) + body)
+        out.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,34 @@
+#!/bin/bash
+# Script handler: each worker keeps this running and writes one request per
+# frame, "<length>\n<request JSON>" (or "@<length>\n" with the JSON on fd 3
+# when it is large). Every reply is "<length>[ <status>]\n<body>".
+
+export LC_ALL=C # lengths are bytes
+
+body_re='\\r\\n\\r\\n(.*)"\}$'
+
+while IFS= read -r frame; do
+    if [[ $frame == @* ]]; then
+        req=$(head -c "${frame#@}" /dev/fd/3)
+    else
+        IFS= read -r -N "$frame" req
+    fi
+
+    method="" query="" body=""
+    [[ $req =~ \"method\":\"([^\"]*)\" ]] && method=${BASH_REMATCH[1]}
+    [[ $req =~ \"path\":\"[^\"?]*\?([^\"]*)\" ]] && query=${BASH_REMATCH[1]}
+    [[ $req =~ $body_re ]] && body=${BASH_REMATCH[1]}
+
+    resp=$(cat <<EOF
+{
+    "status": "success",
+    "handler_type": "Bash Shell Script",
+    "method_used": "$method",
+    "query_string": "$query",
+    "body_length": "${#body}",
+    "first_10_body_chars": "${body:0:10}"
+}
+EOF
+)
+    printf '%d\n%s' "${#resp}" "$resp"
+done
@@ -0,0 +1,40 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <caffeine_handler.h>
+
+const char* handler_ctx(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    caffeine_json_t doc;
+    if (caffeine_json_parse(ctx, ctx->request, ctx->request_len, &doc) < 0) {
+        *result_len = snprintf(response_buffer, buffer_size, "{\"status\": 400, \"body\": \"bad request envelope\"}");
+        return response_buffer;
+    }
+
+    // method and path never need unescaping, the raw slices can be used as they are
+    size_t method_len = 0, path_len = 0;
+    const char *method = caffeine_json_str(&doc, caffeine_json_get(&doc, 0, "method"), &method_len);
+    const char *path = caffeine_json_str(&doc, caffeine_json_get(&doc, 0, "path"), &path_len);
+
+    int written = snprintf(response_buffer, buffer_size,
+        "{\"status\": 200, \"body\": {\"method\": \"%.*s\", \"path\": \"%.*s\", \"tape_nodes\": %u}}",
+        (int)method_len, method, (int)path_len, path, doc.count);
+
+    if (written < 0 || (size_t)written >= buffer_size) {
+        *result_len = written < 0 ? 0 : (size_t)written + 1;
+        return NULL;
+    }
+    *result_len = (size_t)written;
+    return response_buffer;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <caffeine_handler.h>
+
+// decodes the only string in json and writes its bytes in hex, "rejected" when the tape refuses it
+static void decode(caffeine_ctx_t *ctx, const char *json, char *hex, size_t hex_size) {
+    caffeine_json_t doc;
+    char out[32];
+
+    if (caffeine_json_parse(ctx, json, strlen(json), &doc) < 0) {
+        snprintf(hex, hex_size, "rejected");
+        return;
+    }
+    size_t len = caffeine_json_unescape(&doc, 0, out);
+    hex[0] = 0;
+    for (size_t k = 0; k < len && 2 * k + 2 < hex_size; k++)
+        sprintf(hex + 2 * k, "%02x", (unsigned char)out[k]);
+}
+
+const char* handler_ctx(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    char control[32], lone[32], pair[32];
+
+    decode(ctx, "\"a\tb\"", control, sizeof(control));
+    decode(ctx, "\"\\ud800x\"", lone, sizeof(lone));
+    decode(ctx, "\"\\ud83d\\ude00\"", pair, sizeof(pair));
+
+    *result_len = snprintf(response_buffer, buffer_size,
+        "{\"status\": 200, \"body\": {\"control_byte\": \"%s\", \"lone_surrogate\": \"%s\", \"pair\": \"%s\"}}",
+        control, lone, pair);
+    return response_buffer;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+#include <caffeine_handler.h>
+
+static const char PAGE[] =
+    "<!doctype html>\n"
+    "<html><body><h1>Hello from a raw handler</h1></body></html>\n";
+
+const char* handler_ctx(
+    caffeine_ctx_t *ctx,
+    char *response_buffer,
+    size_t buffer_size,
+    size_t *result_len
+) {
+    // The bytes below go to the client as-is, no JSON envelope involved.
+    caffeine_raw(ctx, 200, "text/html; charset=utf-8");
+    *result_len = sizeof(PAGE) - 1;
+    return PAGE;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,6 +6,10 @@ extern "C" {
 
 #include <string.h>
 
+// The output never changes: the worker calls handler() once and replays
+// the serialized HTTP response for every later request.
+int static_val = 1;
+
 const char* handler(
     const char *request_data, 
     char *response_buffer, 